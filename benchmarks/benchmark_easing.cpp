@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2012, Willow Garage, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Willow Garage, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "rviz_animated_view_controller/easing.h"
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+using namespace rviz_animated_view_controller;
+
+/** @brief Relative progress in time of range(0) evenly spaced samples. */
+static std::vector<double> makeTimes(size_t count)
+{
+  std::vector<double> times(count);
+  for(size_t i = 0; i < count; ++i)
+    times[i] = static_cast<double>(i) / count;
+  return times;
+}
+
+/** @brief One call per sample, as computeRelativeProgressInSpace() does per frame. */
+static void BM_EasingScalar(benchmark::State& state)
+{
+  const uint8_t profile = static_cast<uint8_t>(state.range(0));
+  const std::vector<double> times = makeTimes(static_cast<size_t>(state.range(1)));
+  std::vector<float> progress(times.size());
+  const CubicBezierEasing bezier;
+  for(auto _ : state)
+  {
+    for(size_t i = 0; i < times.size(); ++i)
+      progress[i] = evaluateEasing(profile, times[i], bezier);
+    benchmark::DoNotOptimize(progress.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(1));
+}
+
+/** @brief All samples in one call, as the trajectory preview and motion blur evaluate them. */
+static void BM_EasingBatch(benchmark::State& state)
+{
+  const uint8_t profile = static_cast<uint8_t>(state.range(0));
+  const std::vector<double> times = makeTimes(static_cast<size_t>(state.range(1)));
+  std::vector<float> progress(times.size());
+  const CubicBezierEasing bezier;
+  for(auto _ : state)
+  {
+    evaluateEasing(profile, times.data(), progress.data(), times.size(), bezier);
+    benchmark::DoNotOptimize(progress.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(1));
+}
+
+static void easingArguments(benchmark::internal::Benchmark* benchmark)
+{
+  for(int profile : {EASING_RISING, EASING_DECLINING, EASING_FULL, EASING_WAVE, EASING_CUBIC, EASING_QUINTIC,
+                     EASING_BEZIER})
+    benchmark->Args({profile, 4096});
+}
+
+BENCHMARK(BM_EasingScalar)->Apply(easingArguments);
+BENCHMARK(BM_EasingBatch)->Apply(easingArguments);
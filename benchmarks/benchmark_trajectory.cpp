@@ -0,0 +1,162 @@
+/*
+ * Copyright (c) 2012, Willow Garage, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Willow Garage, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "allocation_counter.h"
+
+#include "rviz_animated_view_controller/compiled_trajectory.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cmath>
+#include <vector>
+
+using rviz_animated_view_controller::CompiledTrajectory;
+
+struct Keyframe
+{
+  Ogre::Vector3 eye;
+  Ogre::Vector3 focus;
+  Ogre::Vector3 up;
+  double transition_duration;
+};
+
+/** @brief A circle of @a count keyframes, like the trajectories of scripts/benchmark_view_controller.py. */
+static std::vector<Keyframe> makeCircle(size_t count, double duration = 4.0)
+{
+  std::vector<Keyframe> keyframes(count);
+  for(size_t i = 0; i < count; ++i)
+  {
+    const double angle = 2.0 * M_PI * (i + 1) / count;
+    keyframes[i].eye = Ogre::Vector3(10.0f * static_cast<float>(cos(angle)), 10.0f * static_cast<float>(sin(angle)), 5.0f);
+    keyframes[i].focus = Ogre::Vector3::ZERO;
+    keyframes[i].up = Ogre::Vector3::UNIT_Z;
+    keyframes[i].transition_duration = duration / count;
+  }
+  return keyframes;
+}
+
+static void append(CompiledTrajectory& trajectory, const std::vector<Keyframe>& keyframes)
+{
+  trajectory.reserve(keyframes.size());
+  for(const Keyframe& keyframe : keyframes)
+    trajectory.append(keyframe.eye, keyframe.focus, keyframe.up, keyframe.transition_duration, 0);
+}
+
+/** @brief Compiles a whole trajectory of range(0) keyframes, as the trajectory callback does once per message. */
+static void BM_TrajectoryIngest(benchmark::State& state)
+{
+  const std::vector<Keyframe> keyframes = makeCircle(static_cast<size_t>(state.range(0)));
+  for(auto _ : state)
+  {
+    CompiledTrajectory trajectory;
+    trajectory.append(Ogre::Vector3::UNIT_X, Ogre::Vector3::ZERO, Ogre::Vector3::UNIT_Z, 0.0, 0);
+    append(trajectory, keyframes);
+    benchmark::DoNotOptimize(trajectory.getDuration());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_TrajectoryIngest)->RangeMultiplier(10)->Range(10, 100000);
+
+/** @brief Appends range(0) keyframes in messages of 10 keyframes each, like a streamed or chunked trajectory. */
+static void BM_TrajectoryIngestChunked(benchmark::State& state)
+{
+  const std::vector<Keyframe> chunk = makeCircle(10);
+  const size_t chunks = static_cast<size_t>(state.range(0)) / chunk.size();
+  for(auto _ : state)
+  {
+    CompiledTrajectory trajectory;
+    trajectory.append(Ogre::Vector3::UNIT_X, Ogre::Vector3::ZERO, Ogre::Vector3::UNIT_Z, 0.0, 0);
+    for(size_t i = 0; i < chunks; ++i)
+      append(trajectory, chunk);
+    benchmark::DoNotOptimize(trajectory.getDuration());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_TrajectoryIngestChunked)->RangeMultiplier(10)->Range(10, 100000);
+
+/** @brief Samples and interpolates one frame of a trajectory of range(0) keyframes, as update() does per frame. */
+static void BM_TrajectorySampleFrame(benchmark::State& state)
+{
+  CompiledTrajectory trajectory;
+  trajectory.append(Ogre::Vector3::UNIT_X, Ogre::Vector3::ZERO, Ogre::Vector3::UNIT_Z, 0.0, 0);
+  append(trajectory, makeCircle(static_cast<size_t>(state.range(0))));
+
+  // 30 fps across the whole trajectory, wrapping around
+  const double frame_period = 1.0 / 30.0;
+  double time = 0.0;
+  size_t movement = 0;
+  double progress = 0.0;
+  Ogre::Vector3 eye, focus, up;
+
+  const size_t allocations_at_start = countAllocations();
+  for(auto _ : state)
+  {
+    time += frame_period;
+    if(time >= trajectory.getDuration())
+      time = 0.0;
+    trajectory.sample(time, movement, progress);
+    trajectory.interpolateSpline(movement, static_cast<float>(progress), eye, focus, up);
+    benchmark::DoNotOptimize(eye);
+  }
+  state.counters["allocations_per_frame"] =
+      benchmark::Counter(static_cast<double>(countAllocations() - allocations_at_start) / state.iterations());
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TrajectorySampleFrame)->RangeMultiplier(10)->Range(10, 100000);
+
+/** @brief Plays a bounded ring of range(0) slots while keyframes stream in, one keyframe per frame. */
+static void BM_TrajectoryStreamFrame(benchmark::State& state)
+{
+  CompiledTrajectory trajectory;
+  trajectory.setMaxSize(static_cast<size_t>(state.range(0)));
+  trajectory.append(Ogre::Vector3::UNIT_X, Ogre::Vector3::ZERO, Ogre::Vector3::UNIT_Z, 0.0, 0);
+  const std::vector<Keyframe> keyframes = makeCircle(1000);
+
+  double time = 0.0;
+  size_t movement = 0, next = 0;
+  double progress = 0.0;
+  Ogre::Vector3 eye, focus, up;
+
+  const size_t allocations_at_start = countAllocations();
+  for(auto _ : state)
+  {
+    const Keyframe& keyframe = keyframes[next++ % keyframes.size()];
+    trajectory.append(keyframe.eye, keyframe.focus, keyframe.up, 1.0 / 30.0, 0);
+    time += 1.0 / 30.0;
+    trajectory.sample(time, movement, progress);
+    trajectory.interpolateLinear(movement, static_cast<float>(progress), eye, focus, up);
+    trajectory.discardPlayedMovements();
+    benchmark::DoNotOptimize(eye);
+  }
+  state.counters["allocations_per_frame"] =
+      benchmark::Counter(static_cast<double>(countAllocations() - allocations_at_start) / state.iterations());
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TrajectoryStreamFrame)->Arg(64)->Arg(4096);
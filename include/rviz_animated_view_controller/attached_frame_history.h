@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2012, Willow Garage, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Willow Garage, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef RVIZ_ANIMATED_VIEW_CONTROLLER_ATTACHED_FRAME_HISTORY_H
+#define RVIZ_ANIMATED_VIEW_CONTROLLER_ATTACHED_FRAME_HISTORY_H
+
+#include <ros/time.h>
+
+#include <OGRE/OgreQuaternion.h>
+#include <OGRE/OgreVector3.h>
+
+#include <deque>
+#include <string>
+
+namespace rviz_animated_view_controller
+{
+
+/** @brief A ring of recent stamped poses of the attached frame in the fixed frame.
+ *
+ * update() records the latest transform of the attached frame every frame. Animations look the reference pose up
+ * at the time their frame is sampled at instead of using whatever transform arrived last, so a fast moving
+ * target frame whose transforms arrive late or irregularly does not make the camera jitter.
+ */
+class AttachedFrameHistory
+{
+public:
+  struct Pose
+  {
+    Pose() : orientation(Ogre::Quaternion::IDENTITY), position(Ogre::Vector3::ZERO) {}
+
+    ros::Time stamp;
+    Ogre::Quaternion orientation;
+    Ogre::Vector3 position;
+  };
+
+  explicit AttachedFrameHistory(size_t capacity = 16);
+
+  /** @brief Changes the number of poses kept, dropping the oldest ones if necessary. */
+  void setCapacity(size_t capacity);
+
+  /** @brief Drops all poses if @a frame or @a fixed_frame are not the frames they were recorded for. */
+  void setFrames(const std::string& fixed_frame, const std::string& frame);
+
+  void clear() { poses_.clear(); }
+
+  /** @brief Appends a pose of the frame, poses which are not newer than the latest one are ignored. */
+  void add(const ros::Time& stamp, const Ogre::Vector3& position, const Ogre::Quaternion& orientation);
+
+  /** @brief Interpolates the pose of the frame at @a time.
+   *
+   * In between two recorded poses the position is interpolated linearly and the orientation spherically. Beyond
+   * the latest pose the motion of the last two poses is extrapolated for at most @a max_extrapolation seconds,
+   * after that the pose is held. Times before the oldest pose return the oldest pose.
+   *
+   * @returns false if no pose was recorded yet.
+   */
+  bool lookup(const ros::Time& time, double max_extrapolation, Ogre::Vector3& position,
+              Ogre::Quaternion& orientation) const;
+
+  bool empty() const { return poses_.empty(); }
+
+  size_t size() const { return poses_.size(); }
+
+private:
+  std::string fixed_frame_;
+  std::string frame_;
+  size_t capacity_;
+  std::deque<Pose> poses_;   ///< Oldest pose first.
+};
+
+}  // namespace rviz_animated_view_controller
+
+#endif // RVIZ_ANIMATED_VIEW_CONTROLLER_ATTACHED_FRAME_HISTORY_H
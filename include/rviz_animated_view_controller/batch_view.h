@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2012, Willow Garage, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Willow Garage, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef RVIZ_ANIMATED_VIEW_CONTROLLER_BATCH_VIEW_H
+#define RVIZ_ANIMATED_VIEW_CONTROLLER_BATCH_VIEW_H
+
+#include <ros/subscriber.h>
+
+#include <OGRE/OgreQuaternion.h>
+#include <OGRE/OgreVector3.h>
+
+#include "rviz_animated_view_controller/compiled_trajectory.h"
+#include "rviz_animated_view_controller/image_buffer_pool.h"
+#include "rviz_animated_view_controller/offscreen_render_target.h"
+#include "rviz_animated_view_controller/pbo_frame_grabber.h"
+
+#include <string>
+
+namespace Ogre
+{
+class Camera;
+class SceneManager;
+class SceneNode;
+}
+
+namespace rviz_animated_view_controller
+{
+
+/** @brief An additional camera rendered offscreen in the same frames as the main view.
+ *
+ * Every batch view follows a trajectory of its own, received on /rviz/batch_view_<index>/camera_trajectory, which
+ * is sampled at the time of the main trajectory. All views of a frame therefore show the same state of the scene,
+ * while the displays only update once per frame for all of them. The view images are published on
+ * /rviz/batch_view_<index>/view_image.
+ *
+ * The camera is attached to the attached frame of the view controller, like the main camera.
+ */
+struct BatchView
+{
+  BatchView(unsigned int index, Ogre::SceneManager* scene_manager, Ogre::SceneNode* attached_scene_node);
+  ~BatchView();
+
+  BatchView(const BatchView&) = delete;
+  BatchView& operator=(const BatchView&) = delete;
+
+  /** @brief Returns the namespace of the topics of the batch view with @a index. */
+  static std::string getTopicNamespace(unsigned int index);
+
+  /** @brief Moves the camera to the pose stored in eye, focus and up, relative to the attached frame.
+   *
+   * @param[in] main_camera            near and far clip distance and field of view are copied from it.
+   * @param[in] reference_orientation  orientation of the attached frame.
+   * @param[in] fixed_up               whether the yaw axis of the camera is fixed to the up vector.
+   */
+  void updateCamera(const Ogre::Camera* main_camera, const Ogre::Quaternion& reference_orientation, bool fixed_up);
+
+  /** @brief Like updateCamera(), but moves the camera to the given pose instead, e.g. to a motion blur sub-frame. */
+  void updateCamera(const Ogre::Camera* main_camera, const Ogre::Quaternion& reference_orientation, bool fixed_up,
+                    const Ogre::Vector3& eye, const Ogre::Vector3& focus, const Ogre::Vector3& up);
+
+  unsigned int index;
+  Ogre::SceneManager* scene_manager;
+  Ogre::Camera* camera;
+
+  CompiledTrajectory trajectory;
+  double start_time;            ///< Time of the main trajectory at which the trajectory of this view started.
+  bool active;                  ///< True once the view received a trajectory for the current animation.
+
+  // pose shown last, the next trajectory starts from here
+  Ogre::Vector3 eye;
+  Ogre::Vector3 focus;
+  Ogre::Vector3 up;
+
+  OffscreenRenderTarget render_target;
+  ImageBufferPool image_pool;
+  PboFrameGrabber frame_grabber;
+
+  ros::Subscriber trajectory_subscriber;
+};
+
+}  // namespace rviz_animated_view_controller
+
+#endif // RVIZ_ANIMATED_VIEW_CONTROLLER_BATCH_VIEW_H
@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2012, Willow Garage, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Willow Garage, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef RVIZ_ANIMATED_VIEW_CONTROLLER_CAMERA_COMMAND_H
+#define RVIZ_ANIMATED_VIEW_CONTROLLER_CAMERA_COMMAND_H
+
+#include <ros/time.h>
+
+#include <OGRE/OgreVector3.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace rviz_animated_view_controller
+{
+
+/** @brief A camera movement already transformed into the attached frame. */
+struct OgreCameraMovement
+{
+  OgreCameraMovement() : transition_duration(0.0), interpolation_speed(0) {}
+
+  Ogre::Vector3 eye;
+  Ogre::Vector3 focus;
+  Ogre::Vector3 up;
+
+  double transition_duration;
+  uint8_t interpolation_speed;
+};
+
+/** @brief A request received by one of the subscriber callbacks.
+ *
+ * The callbacks run on the view controller's own spinner thread. They deserialize and transform the incoming
+ * messages into commands, which update() applies on the render thread.
+ */
+struct CameraCommand
+{
+  enum Type { MOVE = 0,    ///< Apply the control parameters and append the movements.
+              PAUSE,       ///< Pause for pause_duration of the trajectory clock, or until resumed if it is zero.
+              RESUME,
+              SEEK,        ///< Jump to seek_time of the trajectory.
+              BATCH_MOVE,  ///< Append the movements to the trajectory of batch_view.
+              PREVIEW,     ///< Preview the movements without playing them.
+              STREAM};     ///< Like MOVE, but the movements are appended to a trajectory of bounded size.
+
+  explicit CameraCommand(Type type = MOVE)
+    : type(type)
+      , interaction_disabled(false)
+      , allow_free_yaw_axis(false)
+      , mouse_interaction_mode(0)
+      , render_frame_by_frame(false)
+      , frames_per_second(0)
+      , batch_view(0)
+  {
+  }
+
+  Type type;
+
+  // MOVE and STREAM
+  bool interaction_disabled;
+  bool allow_free_yaw_axis;
+  uint8_t mouse_interaction_mode;     ///< One of the CameraTrajectory interaction modes.
+  std::string target_frame;           ///< Frame the movements are expressed in, empty to keep the attached frame.
+  bool render_frame_by_frame;         ///< If false, the frame-by-frame mode is left unchanged.
+  int frames_per_second;
+  std::vector<OgreCameraMovement> movements;   ///< Also used by BATCH_MOVE and PREVIEW.
+
+  // PAUSE
+  ros::Duration pause_duration;
+
+  // SEEK
+  ros::Duration seek_time;
+
+  // BATCH_MOVE, uses movements
+  unsigned int batch_view;
+};
+
+}  // namespace rviz_animated_view_controller
+
+#endif // RVIZ_ANIMATED_VIEW_CONTROLLER_CAMERA_COMMAND_H
@@ -0,0 +1,192 @@
+/*
+ * Copyright (c) 2012, Willow Garage, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Willow Garage, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef RVIZ_ANIMATED_VIEW_CONTROLLER_COMPILED_TRAJECTORY_H
+#define RVIZ_ANIMATED_VIEW_CONTROLLER_COMPILED_TRAJECTORY_H
+
+#include <OGRE/OgreVector3.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace rviz_animated_view_controller
+{
+
+/** @brief A camera trajectory stored as a contiguous, time-indexed array of keyframes.
+ *
+ * Keyframe 0 is the pose the camera starts from. Every further keyframe is the goal of the movement from its
+ * predecessor and stores the absolute time the camera reaches it, so the trajectory is sampled by its time since
+ * the start instead of consuming movements one by one. Times are accumulated once when a keyframe is appended and
+ * never drift with the frame rate.
+ *
+ * The keyframes live in a ring, so played keyframes are dropped from its front in constant time and their slots
+ * are reused by the keyframes appended next. The ring grows as needed unless setMaxSize() bounds it, which allocates
+ * all slots once and keeps the memory constant no matter how long keyframes are streamed in.
+ */
+class CompiledTrajectory
+{
+public:
+  struct Keyframe
+  {
+    Keyframe() : end_time(0.0), interpolation_speed(0) {}
+
+    Ogre::Vector3 eye;
+    Ogre::Vector3 focus;
+    Ogre::Vector3 up;
+
+    double end_time;              ///< Seconds since the start of the trajectory at which this pose is reached.
+    uint8_t interpolation_speed;  ///< Speed profile of the movement towards this pose.
+  };
+
+  CompiledTrajectory();
+
+  /** @brief Removes all keyframes, keeping the allocated slots. */
+  void clear();
+
+  /** @brief Makes room for @a additional_keyframes more keyframes, so appending them does not reallocate.
+   *
+   * The ring at least doubles when it grows, so reserving before every appended message stays amortized constant
+   * per keyframe. A bounded ring never reallocates, setMaxSize() allocated all of its slots.
+   */
+  void reserve(size_t additional_keyframes);
+
+  /** @brief Limits the trajectory to @a max_size keyframes, whose slots are allocated right away. 0 removes the limit.
+   *
+   * Keyframes beyond a new limit are kept, only appending is refused until enough of them were played.
+   */
+  void setMaxSize(size_t max_size);
+
+  size_t getMaxSize() const { return max_size_; }
+
+  /** @brief Number of allocated slots. */
+  size_t getCapacity() const { return keyframes_.size(); }
+
+  /** @brief True if a maximum size is set and reached, so append() would be refused. */
+  bool isFull() const { return max_size_ > 0 && size_ >= max_size_; }
+
+  /** @brief Appends the pose the camera moves to in @a transition_duration seconds after the last keyframe.
+   *
+   * The first keyframe appended to an empty trajectory is the start pose, its duration is ignored.
+   *
+   * @returns false if the trajectory isFull(), the keyframe is not appended then.
+   */
+  bool append(const Ogre::Vector3& eye, const Ogre::Vector3& focus, const Ogre::Vector3& up,
+              double transition_duration, uint8_t interpolation_speed);
+
+  /** @brief Looks up the movement played at @a time. Requires hasMovement().
+   *
+   * Playback usually moves forward by less than a movement per call, so the movement found last is tried first and
+   * a binary search is only needed after jumps.
+   *
+   * @param[in]  time                      seconds since the start of the trajectory.
+   * @param[out] movement                  index of the goal keyframe of the movement, the start keyframe is the one before.
+   * @param[out] relative_progress_in_time progress of the movement between 0.0 and 1.0.
+   *
+   * @returns false if @a time lies beyond the end of the trajectory, in which case the last movement is returned
+   * as completed.
+   */
+  bool sample(double time, size_t& movement, double& relative_progress_in_time);
+
+  /** @brief Interpolates eye, focus and up linearly between the start and the goal keyframe of @a movement.
+   *
+   * @param[in]  movement                    index of the goal keyframe, see sample().
+   * @param[in]  relative_progress_in_space  0.0 at the start keyframe, 1.0 at the goal keyframe.
+   * @param[out] eye, focus, up              the interpolated camera.
+   */
+  void interpolateLinear(size_t movement, float relative_progress_in_space,
+                         Ogre::Vector3& eye, Ogre::Vector3& focus, Ogre::Vector3& up) const;
+
+  /** @brief Like interpolateLinear(), but the eye orbits the focus and the up vector is rotated.
+   *
+   * The direction from the focus to the eye and the up vector are slerped, their lengths are interpolated linearly.
+   */
+  void interpolateSpherical(size_t movement, float relative_progress_in_space,
+                            Ogre::Vector3& eye, Ogre::Vector3& focus, Ogre::Vector3& up) const;
+
+  /** @brief Interpolates eye and focus along a Catmull-Rom spline through all keyframes and slerps the up vector.
+   *
+   * The spline is a cubic Hermite curve per movement whose tangents are the central differences of the neighbouring
+   * keyframes over their time span, so the camera velocity is continuous across keyframes of different durations
+   * (given a linear speed profile) and sparse keyframes result in smooth motion.
+   */
+  void interpolateSpline(size_t movement, float relative_progress_in_space,
+                         Ogre::Vector3& eye, Ogre::Vector3& focus, Ogre::Vector3& up) const;
+
+  /** @brief Drops the keyframes of movements that were played already, keeping the keyframe times unchanged.
+   *
+   * Without a maximum size, played keyframes are kept until enough accumulated, so a trajectory can be sought
+   * back for a while. A bounded trajectory recycles them right away to make room for the next keyframes.
+   */
+  void discardPlayedMovements();
+
+  /** @brief True if there is at least one movement, i.e. a start and a goal keyframe. */
+  bool hasMovement() const { return size_ >= 2; }
+
+  bool empty() const { return size_ == 0; }
+  size_t size() const { return size_; }
+
+  /** @brief Number of keyframes the camera did not reach yet by the time sampled last. */
+  size_t getPendingKeyframes() const { return size_ > cursor_ ? size_ - cursor_ : 0; }
+
+  /** @brief Seconds since the start of the trajectory until the last keyframe is reached. */
+  double getDuration() const { return size_ == 0 ? 0.0 : at(size_ - 1).end_time; }
+
+  /** @brief Seconds since the start of the trajectory at which the movement towards keyframe @a movement starts. */
+  double getStartTime(size_t movement) const { return at(movement - 1).end_time; }
+
+  const Keyframe& operator[](size_t index) const { return at(index); }
+
+private:
+  /** @brief Returns keyframe @a index, counted from the oldest keyframe kept. */
+  const Keyframe& at(size_t index) const
+  {
+    index += head_;
+    return keyframes_[index < keyframes_.size() ? index : index - keyframes_.size()];
+  }
+
+  Keyframe& at(size_t index)
+  {
+    return const_cast<Keyframe&>(static_cast<const CompiledTrajectory*>(this)->at(index));
+  }
+
+  /** @brief Moves the keyframes into a ring of @a capacity slots, oldest first. */
+  void reallocate(size_t capacity);
+
+  /** @brief Rotates @a from towards @a to by the fraction @a t of the angle between them and interpolates the length. */
+  static Ogre::Vector3 slerpVector(const Ogre::Vector3& from, const Ogre::Vector3& to, float t);
+
+  std::vector<Keyframe> keyframes_;   ///< Slots of the ring, all of them allocated.
+  size_t head_;         ///< Slot of keyframe 0.
+  size_t size_;         ///< Number of keyframes in the ring.
+  size_t max_size_;     ///< 0 if the ring grows as needed.
+  size_t cursor_;       ///< Goal keyframe of the movement sampled last, size_ once the last one was reached.
+};
+
+}  // namespace rviz_animated_view_controller
+
+#endif // RVIZ_ANIMATED_VIEW_CONTROLLER_COMPILED_TRAJECTORY_H
@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) 2012, Willow Garage, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Willow Garage, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef RVIZ_ANIMATED_VIEW_CONTROLLER_EASING_H
+#define RVIZ_ANIMATED_VIEW_CONTROLLER_EASING_H
+
+#include <view_controller_msgs/CameraMovement.h>
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace rviz_animated_view_controller
+{
+
+/** @brief Speed profiles of camera movements, the interpolation_speed of a CameraMovement.
+ *
+ * The first four are the ones of view_controller_msgs::CameraMovement. The others are ours; senders that do not
+ * know them never send their values, older versions of the view controller play them as WAVE.
+ */
+enum EasingProfile : uint8_t { EASING_RISING = view_controller_msgs::CameraMovement::RISING,
+                               EASING_DECLINING = view_controller_msgs::CameraMovement::DECLINING,
+                               EASING_FULL = view_controller_msgs::CameraMovement::FULL,
+                               EASING_WAVE = view_controller_msgs::CameraMovement::WAVE,
+                               EASING_CUBIC = 4,    ///< Smoothstep, zero speed at both ends.
+                               EASING_QUINTIC = 5,  ///< Smootherstep, zero speed and acceleration at both ends.
+                               EASING_BEZIER = 6};  ///< The CubicBezierEasing configured in the view controller.
+
+/** @brief Converts the relative progress in time into the relative progress in space for one profile.
+ *
+ * Specialized per profile at compile time, so loops over many samples contain no switch. The four profiles of
+ * CameraMovement evaluate exactly the expressions the view controller always used, their results are identical
+ * to the bit.
+ */
+template<uint8_t Profile>
+struct Easing
+{
+  static float evaluate(double t) { return 0.5f * (1.f - static_cast<float>(cos(t * M_PI))); }  // WAVE
+};
+
+template<>
+struct Easing<EASING_RISING>
+{
+  static float evaluate(double t) { return 1.f - static_cast<float>(cos(t * M_PI_2)); }
+};
+
+template<>
+struct Easing<EASING_DECLINING>
+{
+  static float evaluate(double t) { return static_cast<float>(-cos(t * M_PI_2 + M_PI_2)); }
+};
+
+template<>
+struct Easing<EASING_FULL>
+{
+  static float evaluate(double t) { return static_cast<float>(t); }
+};
+
+template<>
+struct Easing<EASING_CUBIC>
+{
+  static float evaluate(double t) { return static_cast<float>(t * t * (3.0 - 2.0 * t)); }
+};
+
+template<>
+struct Easing<EASING_QUINTIC>
+{
+  static float evaluate(double t) { return static_cast<float>(t * t * t * (t * (6.0 * t - 15.0) + 10.0)); }
+};
+
+/** @brief Evaluates one profile for @a count samples in a plain loop without branches.
+ *
+ * Only the FULL, CUBIC and QUINTIC loops can be auto-vectorized, and GCC does so at -O3 only, not at the -O2 of
+ * catkin release builds. RISING, DECLINING and WAVE call the scalar libm cos() and are never vectorized.
+ */
+template<uint8_t Profile>
+void evaluateEasing(const double* times, float* progress, size_t count)
+{
+  for(size_t i = 0; i < count; ++i)
+    progress[i] = Easing<Profile>::evaluate(times[i]);
+}
+
+/** @brief An easing curve defined by a cubic Bezier from (0, 0) to (1, 1), like CSS cubic-bezier().
+ *
+ * The x coordinates of the control points are clamped to [0, 1] so that the curve is a function of time. The y
+ * coordinates may leave [0, 1] to overshoot.
+ */
+class CubicBezierEasing
+{
+public:
+  /** @brief The default is CSS "ease". */
+  CubicBezierEasing(double x1 = 0.25, double y1 = 0.1, double x2 = 0.25, double y2 = 1.0);
+
+  /** @brief Parses "x1, y1, x2, y2".
+   *
+   * @returns false and leaves the curve unchanged if @a text does not hold four numbers.
+   */
+  bool parse(const std::string& text);
+
+  float evaluate(double t) const;
+
+  void evaluate(const double* times, float* progress, size_t count) const;
+
+private:
+  /** @brief Finds the curve parameter at which the curve reaches time @a t. */
+  double solveCurveParameter(double t) const;
+
+  // polynomial coefficients of x(s) = ((ax * s + bx) * s + cx) * s and of y(s)
+  double ax_, bx_, cx_;
+  double ay_, by_, cy_;
+};
+
+/** @brief Evaluates @a profile at @a t, unknown profiles are played as WAVE. */
+float evaluateEasing(uint8_t profile, double t, const CubicBezierEasing& bezier);
+
+/** @brief Evaluates @a profile for @a count samples, dispatching on the profile once for all of them. */
+void evaluateEasing(uint8_t profile, const double* times, float* progress, size_t count,
+                    const CubicBezierEasing& bezier);
+
+}  // namespace rviz_animated_view_controller
+
+#endif // RVIZ_ANIMATED_VIEW_CONTROLLER_EASING_H
@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) 2012, Willow Garage, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Willow Garage, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef RVIZ_ANIMATED_VIEW_CONTROLLER_IMAGE_BUFFER_POOL_H
+#define RVIZ_ANIMATED_VIEW_CONTROLLER_IMAGE_BUFFER_POOL_H
+
+#include <sensor_msgs/Image.h>
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace rviz_animated_view_controller
+{
+
+/** @brief A set of preallocated image messages which are lent out for capturing and return once nobody uses them.
+ *
+ * The pixel data of the view is read back straight into the data vector of a pooled message, so publishing an
+ * image neither allocates nor copies. The images are reference counted: an image only goes back to the pool when
+ * the last shared pointer to it is gone, so subscribers in the same process, which receive the very message that
+ * was published, may keep it as long as they like without it being overwritten. The buffers are only reallocated
+ * when configure() is called with a different image geometry. Images may be acquired and dropped by any thread,
+ * and may outlive the pool.
+ */
+class ImageBufferPool
+{
+public:
+  explicit ImageBufferPool(size_t pool_size = 4);
+
+  /** @brief Sets the geometry of the pooled images, reallocating the buffers only if it changed.
+   *
+   * Images which are currently lent out are resized when they are acquired again.
+   *
+   * @param[in] width            image width in pixels.
+   * @param[in] height           image height in pixels.
+   * @param[in] encoding         one of sensor_msgs::image_encodings.
+   * @param[in] bytes_per_pixel  size of a pixel of the given encoding.
+   * @param[in] data_rows        number of rows in the data if it differs from the height, e.g. the 3/2 height
+   *                             of the planes of an NV12 image. 0 for the image height.
+   *
+   * @returns true if the geometry changed.
+   */
+  bool configure(unsigned int width, unsigned int height, const std::string& encoding, unsigned int bytes_per_pixel,
+                 unsigned int data_rows = 0);
+
+  /** @brief Lends out an image with the configured geometry and data size.
+   *
+   * If all images are lent out, a new one is added to the pool. The image returns to the pool when the last
+   * copy of the returned pointer is destroyed.
+   */
+  sensor_msgs::ImagePtr acquire();
+
+  /** @brief Number of images currently lent out, including those still held by subscribers. */
+  size_t getLentImages() const;
+
+  unsigned int getWidth() const { return width_; }
+  unsigned int getHeight() const { return height_; }
+
+  /** @brief Number of pixel buffers allocated since construction. */
+  unsigned long getAllocations() const { return allocations_; }
+
+private:
+  /** @brief The part of the pool the lent out images return to, kept alive by the images as long as needed. */
+  struct Storage
+  {
+    Storage() : lent_images(0) {}
+
+    mutable std::mutex mutex;
+    std::vector<std::unique_ptr<sensor_msgs::Image>> free_images;
+    size_t lent_images;
+  };
+
+  /** @brief Deleter of the lent out images, gives them back to the storage instead of freeing them. */
+  struct Recycler
+  {
+    std::shared_ptr<Storage> storage;
+
+    void operator()(sensor_msgs::Image* image) const;
+  };
+
+  void allocate(sensor_msgs::Image& image);
+
+  std::shared_ptr<Storage> storage_;
+
+  unsigned int width_;
+  unsigned int height_;
+  std::string encoding_;
+  unsigned int bytes_per_pixel_;
+  unsigned int data_rows_;
+
+  unsigned long allocations_;
+};
+
+}  // namespace rviz_animated_view_controller
+
+#endif // RVIZ_ANIMATED_VIEW_CONTROLLER_IMAGE_BUFFER_POOL_H
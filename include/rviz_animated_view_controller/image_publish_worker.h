@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2012, Willow Garage, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Willow Garage, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef RVIZ_ANIMATED_VIEW_CONTROLLER_IMAGE_PUBLISH_WORKER_H
+#define RVIZ_ANIMATED_VIEW_CONTROLLER_IMAGE_PUBLISH_WORKER_H
+
+#include <ros/time.h>
+
+#include <sensor_msgs/Image.h>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace rviz_animated_view_controller
+{
+
+/** @brief Stamps and publishes captured view images on a dedicated thread.
+ *
+ * The render thread only reads the pixels back and hands the image over with push(). Publishing, including the
+ * compression done by image_transport plugins, runs on the worker thread. The queue between both is bounded: when
+ * it is full, push() either drops the oldest queued image or blocks until the worker caught up.
+ */
+class ImagePublishWorker
+{
+public:
+  enum OverflowPolicy { DROP_OLDEST = 0,
+                        BLOCK};
+
+  typedef std::function<void(const sensor_msgs::ImageConstPtr&, unsigned int stream)> ImageFunction;
+
+  /** @brief Starts the worker thread.
+   *
+   * @param[in] publish  called on the worker thread for every stamped image, with the stream it was pushed to.
+   *                     The image must not be modified anymore, it may be shared with subscribers in the same
+   *                     process.
+   */
+  explicit ImagePublishWorker(const ImageFunction& publish);
+
+  /** @brief Publishes the queued images and joins the worker thread. */
+  ~ImagePublishWorker();
+
+  void setQueueDepth(size_t queue_depth);
+  void setOverflowPolicy(OverflowPolicy policy);
+
+  /** @brief Queues an image for stamping and publishing.
+   *
+   * @param[in] image     captured image, the worker's reference is dropped once it is published or dropped.
+   * @param[in] stamp     time the image was rendered.
+   * @param[in] frame_id  frame the camera was attached to.
+   * @param[in] stream    identifies the publisher, images of all streams share the queue.
+   * @param[in] seq       sequence number written to header.seq.
+   */
+  void push(const sensor_msgs::ImagePtr& image, const ros::Time& stamp, const std::string& frame_id,
+            unsigned int stream = 0, uint32_t seq = 0);
+
+  /** @brief Runs @a task on the worker thread once all images queued before were published.
+   *
+   * Tasks are never dropped and do not count towards the queue depth.
+   */
+  void post(const std::function<void()>& task);
+
+  /** @brief Number of images dropped because the queue was full. */
+  unsigned long getDroppedImages() const { return dropped_images_; }
+
+private:
+  struct Job
+  {
+    sensor_msgs::ImagePtr image;
+    ros::Time stamp;
+    std::string frame_id;
+    unsigned int stream;
+    uint32_t seq;
+    std::function<void()> task;
+  };
+
+  void run();
+
+  ImageFunction publish_;
+
+  std::mutex mutex_;
+  std::condition_variable job_queued_;
+  std::condition_variable job_done_;
+  std::deque<Job> jobs_;
+  size_t queued_images_;
+
+  size_t queue_depth_;
+  OverflowPolicy policy_;
+  unsigned long dropped_images_;
+
+  bool stop_;
+  std::thread thread_;
+};
+
+}  // namespace rviz_animated_view_controller
+
+#endif // RVIZ_ANIMATED_VIEW_CONTROLLER_IMAGE_PUBLISH_WORKER_H
@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2012, Willow Garage, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Willow Garage, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef RVIZ_ANIMATED_VIEW_CONTROLLER_IMAGE_RESAMPLE_PASS_H
+#define RVIZ_ANIMATED_VIEW_CONTROLLER_IMAGE_RESAMPLE_PASS_H
+
+#include <sensor_msgs/Image.h>
+
+#include "rviz_animated_view_controller/shader_pass.h"
+
+namespace rviz_animated_view_controller
+{
+
+/** @brief Crops a region out of a rendered texture and scales it to a given size on the GPU.
+ *
+ * The region is sampled with bilinear filtering, which averages 2x2 blocks when scaling down by two and gets
+ * more selective beyond that. Reading back the result only transfers the pixels actually published, e.g. for
+ * thumbnails next to the full image rendered in the same frame.
+ *
+ * All methods must be called from the thread owning the Ogre GL context.
+ */
+class ImageResamplePass
+{
+public:
+  ImageResamplePass();
+
+  /** @brief Resamples the region of the source texture into a texture of @a width x @a height.
+   *
+   * @param[in] source_texture_id  GL name of the RGB texture, top row first as Ogre renders into textures.
+   * @param[in] source_width       width of the source texture.
+   * @param[in] source_height      height of the source texture.
+   * @param[in] region_x           left column of the region.
+   * @param[in] region_y           top row of the region.
+   * @param[in] region_width       width of the region.
+   * @param[in] region_height      height of the region.
+   * @param[in] width              width of the resulting image.
+   * @param[in] height             height of the resulting image.
+   *
+   * @returns false if the shader could not be built.
+   */
+  bool resample(unsigned int source_texture_id, unsigned int source_width, unsigned int source_height,
+                unsigned int region_x, unsigned int region_y, unsigned int region_width, unsigned int region_height,
+                unsigned int width, unsigned int height);
+
+  /** @brief Synchronously reads the last result into @a image, a bgr8 image of getWidth() x getHeight(). */
+  void copyContentsToMemory(sensor_msgs::Image& image);
+
+  /** @brief Returns the GL name of the texture holding the result, for asynchronous readback. */
+  unsigned int getTextureId() const { return pass_.getTextureId(); }
+
+  unsigned int getWidth() const { return pass_.getWidth(); }
+  unsigned int getHeight() const { return pass_.getHeight(); }
+
+  /** @brief Returns true if the shader failed to build. */
+  bool hasFailed() const { return pass_.hasFailed(); }
+
+  /** @brief Deletes the GL objects. */
+  void release() { pass_.release(); }
+
+private:
+  ShaderPass pass_;
+};
+
+}  // namespace rviz_animated_view_controller
+
+#endif // RVIZ_ANIMATED_VIEW_CONTROLLER_IMAGE_RESAMPLE_PASS_H
@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2012, Willow Garage, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Willow Garage, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef RVIZ_ANIMATED_VIEW_CONTROLLER_NV12_CONVERSION_PASS_H
+#define RVIZ_ANIMATED_VIEW_CONTROLLER_NV12_CONVERSION_PASS_H
+
+#include <sensor_msgs/Image.h>
+
+#include "rviz_animated_view_controller/shader_pass.h"
+
+#include <string>
+
+namespace rviz_animated_view_controller
+{
+
+/** @brief Converts a rendered RGB texture to NV12 in a fragment shader, before the image is read back.
+ *
+ * The result is a single channel texture of the image width and 3/2 of the image height: the full resolution
+ * luma plane on top of the interleaved chroma plane, which is subsampled by two in both directions. Colors are
+ * converted to BT.601 limited range, the input most hardware video encoders expect. Reading back NV12 transfers
+ * 1.5 instead of 3 bytes per pixel.
+ *
+ * NV12 needs even image dimensions, odd ones are rounded down. All methods must be called from the thread owning
+ * the Ogre GL context.
+ */
+class Nv12ConversionPass
+{
+public:
+  static const std::string ENCODING;  ///< "nv12", which sensor_msgs::image_encodings does not define.
+
+  Nv12ConversionPass();
+
+  /** @brief Converts the texture, (re)creating the target texture if the geometry changed.
+   *
+   * @param[in] source_texture_id  GL name of the RGB texture, top row first as Ogre renders into textures.
+   * @param[in] width              width of the source texture.
+   * @param[in] height             height of the source texture.
+   *
+   * @returns false if the shader could not be built, in which case hasFailed() returns true from then on.
+   */
+  bool convert(unsigned int source_texture_id, unsigned int width, unsigned int height);
+
+  /** @brief Synchronously reads the last converted image into @a image.
+   *
+   * @a image must be an NV12 image of getWidth() and getHeight(), i.e. of getWidth() * getHeight() * 3 / 2 bytes.
+   */
+  void copyContentsToMemory(sensor_msgs::Image& image);
+
+  /** @brief Returns the GL name of the texture holding the converted image, for asynchronous readback. */
+  unsigned int getTextureId() const { return pass_.getTextureId(); }
+
+  /** @brief Width of the converted image. */
+  unsigned int getWidth() const { return width_; }
+
+  /** @brief Height of the converted image, the texture has 3/2 as many rows. */
+  unsigned int getHeight() const { return height_; }
+
+  /** @brief Returns true if the shader failed to build. */
+  bool hasFailed() const { return pass_.hasFailed(); }
+
+  /** @brief Deletes the GL objects. */
+  void release();
+
+private:
+  ShaderPass pass_;
+  unsigned int width_;
+  unsigned int height_;
+};
+
+}  // namespace rviz_animated_view_controller
+
+#endif // RVIZ_ANIMATED_VIEW_CONTROLLER_NV12_CONVERSION_PASS_H
@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2012, Willow Garage, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Willow Garage, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef RVIZ_ANIMATED_VIEW_CONTROLLER_OFFSCREEN_RENDER_TARGET_H
+#define RVIZ_ANIMATED_VIEW_CONTROLLER_OFFSCREEN_RENDER_TARGET_H
+
+#include <sensor_msgs/Image.h>
+
+#include <OGRE/OgreColourValue.h>
+#include <OGRE/OgreTexture.h>
+
+#include "rviz_animated_view_controller/shader_pass.h"
+
+#include <string>
+
+namespace Ogre
+{
+class Camera;
+}
+
+namespace rviz_animated_view_controller
+{
+
+/** @brief Renders a camera into a texture of arbitrary size, independent of the visible render panel.
+ *
+ * With a supersampling factor larger than one the scene is rendered at that multiple of the requested size and
+ * every block of factor x factor pixels is averaged into one on the GPU, so the read back image has the requested
+ * size. Multisampling renders with MSAA, which
+ * Ogre resolves on the GPU as well. Sub-frames rendered with accumulate() are averaged on the GPU, e.g. for motion
+ * blur, so in every case only the final image is read back.
+ */
+class OffscreenRenderTarget
+{
+public:
+  OffscreenRenderTarget();
+  ~OffscreenRenderTarget();
+
+  /** @brief Creates the render textures, or recreates them if the geometry changed.
+   *
+   * @param[in] camera         the camera to render.
+   * @param[in] width          width of the resulting image in pixels.
+   * @param[in] height         height of the resulting image in pixels.
+   * @param[in] supersampling  factor by which the scene is rendered larger than the resulting image, at most 4.
+   * @param[in] multisampling  MSAA samples per pixel, 0 to render without. Ogre falls back to what the GPU supports.
+   */
+  void configure(Ogre::Camera* camera, unsigned int width, unsigned int height, unsigned int supersampling,
+                 unsigned int multisampling = 0);
+
+  void setBackgroundColour(const Ogre::ColourValue& colour);
+
+  /** @brief Renders the camera into the texture. The aspect ratio of the camera is restored afterwards. */
+  void render();
+
+  /** @brief Renders the camera like render() and averages it with the sub-frames accumulated since @a sample 0.
+   *
+   * The result is the mean of sub-frames 0 to @a sample, until the next render().
+   *
+   * @returns false if the accumulation shader is not available, the result is undefined then.
+   */
+  bool accumulate(unsigned int sample);
+
+  /** @brief Synchronously reads the last rendered image into @a image, which must have the target's geometry. */
+  void copyContentsToMemory(sensor_msgs::Image& image);
+
+  /** @brief Returns the GL name of the texture holding the resulting image, for asynchronous readback. */
+  unsigned int getTextureId() const;
+
+  bool isValid() const { return !output_texture_.isNull(); }
+  unsigned int getWidth() const { return width_; }
+  unsigned int getHeight() const { return height_; }
+
+  /** @brief Releases the textures. */
+  void destroy();
+
+private:
+  /** @brief Renders the camera into the scene texture and downsamples it into the output texture. */
+  void renderScene();
+
+  /** @brief Returns the GL name of the texture renderScene() left the downsampled scene in. */
+  unsigned int getSceneResultTextureId() const;
+
+  Ogre::TexturePtr createTexture(const std::string& name, unsigned int width, unsigned int height,
+                                 unsigned int multisampling);
+  void destroyTexture(Ogre::TexturePtr& texture);
+
+  Ogre::Camera* camera_;
+  Ogre::TexturePtr output_texture_;         ///< Holds the resulting image; the scene is rendered here directly without supersampling.
+  Ogre::TexturePtr supersampled_texture_;   ///< The scene at supersampling times the resulting size.
+
+  unsigned int width_;
+  unsigned int height_;
+  unsigned int supersampling_;
+  unsigned int multisampling_;
+  Ogre::ColourValue background_colour_;
+
+  ShaderPass downsampling_pass_;    ///< Box filter from the supersampled texture to the resulting size.
+  bool downsampled_;                ///< True if the scene is in the downsampling_pass_ instead of the output texture.
+  ShaderPass accumulation_pass_;    ///< Running average of the sub-frames in half float precision.
+  bool accumulated_;                ///< True if the result is in the accumulation_pass_ instead of the output texture.
+
+  std::string name_;
+};
+
+}  // namespace rviz_animated_view_controller
+
+#endif // RVIZ_ANIMATED_VIEW_CONTROLLER_OFFSCREEN_RENDER_TARGET_H
@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2012, Willow Garage, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Willow Garage, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef RVIZ_ANIMATED_VIEW_CONTROLLER_OUTPUT_MANAGER_H
+#define RVIZ_ANIMATED_VIEW_CONTROLLER_OUTPUT_MANAGER_H
+
+#include <boost/function.hpp>
+
+#include <array>
+#include <atomic>
+
+namespace rviz_animated_view_controller
+{
+
+/** @brief Tracks which outputs of the view controller have subscribers.
+ *
+ * The publishers are advertised with the callbacks returned by connectCallback() and disconnectCallback(), which
+ * count the subscribers of every output as they come and go. Unlike getNumSubscribers() on the publishers, which
+ * takes the publication's lock, asking hasSubscribers() is a single atomic load, so the render thread can skip
+ * all work for an output, e.g. capture, readback and pose math, before doing any of it. The callbacks may run on any
+ * spinner thread.
+ */
+class OutputManager
+{
+public:
+  enum Output { CAMERA_POSE,    ///< /rviz/current_camera_pose
+                VIEW_IMAGE,     ///< /rviz/view_image, every transport counts as a subscriber of its own.
+                PREVIEW_IMAGE,  ///< /rviz/view_image_preview
+                STATISTICS,     ///< /rviz/view_controller_stats
+                OUTPUT_COUNT };
+
+  /** @brief Returns a connect callback for ros or image_transport publishers of @a output. */
+  template<class SingleSubscriberPublisher>
+  boost::function<void(const SingleSubscriberPublisher&)> connectCallback(Output output)
+  {
+    return [this, output](const SingleSubscriberPublisher&){ onConnect(output); };
+  }
+
+  /** @brief Returns a disconnect callback for ros or image_transport publishers of @a output. */
+  template<class SingleSubscriberPublisher>
+  boost::function<void(const SingleSubscriberPublisher&)> disconnectCallback(Output output)
+  {
+    return [this, output](const SingleSubscriberPublisher&){ onDisconnect(output); };
+  }
+
+  void onConnect(Output output);
+  void onDisconnect(Output output);
+
+  bool hasSubscribers(Output output) const { return outputs_[output].subscribers.load(std::memory_order_relaxed) > 0; }
+
+  /** @brief Returns true once after a subscriber connected to @a output since the last call.
+   *
+   * Lets outputs which only publish on change, like the camera pose, send their current state to new subscribers.
+   */
+  bool takeNewSubscriber(Output output);
+
+private:
+  struct State
+  {
+    State() : subscribers(0), new_subscriber(false) {}
+
+    std::atomic<int> subscribers;
+    std::atomic<bool> new_subscriber;
+  };
+
+  std::array<State, OUTPUT_COUNT> outputs_;
+};
+
+}  // namespace rviz_animated_view_controller
+
+#endif // RVIZ_ANIMATED_VIEW_CONTROLLER_OUTPUT_MANAGER_H
@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) 2012, Willow Garage, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Willow Garage, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef RVIZ_ANIMATED_VIEW_CONTROLLER_PBO_FRAME_GRABBER_H
+#define RVIZ_ANIMATED_VIEW_CONTROLLER_PBO_FRAME_GRABBER_H
+
+#include <ros/time.h>
+
+#include <sensor_msgs/Image.h>
+
+#include <vector>
+
+namespace rviz_animated_view_controller
+{
+
+/** @brief Reads back rendered frames asynchronously through a ring of OpenGL pixel buffer objects.
+ *
+ * grab() only queues the transfer of the rendered frame into the next buffer of the ring and returns
+ * immediately, so the copy overlaps with rendering the following frames. retrieve() maps the oldest buffer once
+ * the ring is full, i.e. frames come out (ring size - 1) grabs later, together with the stamp they were grabbed with.
+ *
+ * All methods must be called from the thread owning the Ogre GL context.
+ */
+class PboFrameGrabber
+{
+public:
+  enum Format { BGR8,   ///< Three channel texture or window.
+                NV12};  ///< Single channel texture of the NV12 planes, see Nv12ConversionPass.
+
+  explicit PboFrameGrabber(unsigned int ring_size = 3);
+  ~PboFrameGrabber();
+
+  /** @brief Changes the number of buffers in the ring. Pending frames are discarded. */
+  void setRingSize(unsigned int ring_size);
+
+  unsigned int getRingSize() const { return static_cast<unsigned int>(slots_.size()); }
+
+  /** @brief Starts an asynchronous BGR readback of a region of the back buffer of the current context's window.
+   *
+   * The caller has to make the GL context of the render window current first. If the slot to be written still
+   * holds a frame that was not retrieved, that frame is dropped.
+   *
+   * @param[in] x       left column of the region to read.
+   * @param[in] y       bottom row of the region to read, GL window coordinates start at the lower left corner.
+   * @param[in] width   width of the region to read.
+   * @param[in] height  height of the region to read.
+   * @param[in] stamp   time the frame was rendered, handed back by retrieve().
+   */
+  void grab(unsigned int x, unsigned int y, unsigned int width, unsigned int height, const ros::Time& stamp);
+
+  /** @brief Starts an asynchronous readback of a texture, e.g. the one of an OffscreenRenderTarget.
+   *
+   * @param[in] texture_id  GL name of the texture.
+   * @param[in] width       width of the image.
+   * @param[in] height      height of the image; an NV12 texture has 3/2 as many rows.
+   * @param[in] stamp       time the frame was rendered, handed back by retrieve().
+   * @param[in] format      layout of the texture, which also selects the encoding of the retrieved image.
+   */
+  void grabTexture(unsigned int texture_id, unsigned int width, unsigned int height, const ros::Time& stamp,
+                   Format format = BGR8);
+
+  /** @brief Synchronously reads a region of the back buffer of the current context's window into @a image.
+   *
+   * The synchronous counterpart of grab(): the rows are flipped so that @a image starts with the top row, and
+   * @a image has to hold width * height BGR pixels already.
+   *
+   * @param[in]  x       left column of the region to read.
+   * @param[in]  y       bottom row of the region to read, GL window coordinates start at the lower left corner.
+   * @param[in]  width   width of the region to read.
+   * @param[in]  height  height of the region to read.
+   * @param[out] image   receives the pixel data.
+   */
+  static void readWindow(unsigned int x, unsigned int y, unsigned int width, unsigned int height,
+                         sensor_msgs::Image& image);
+
+  /** @brief Copies the oldest pending frame into @a image, top row first.
+   *
+   * @param[out] image  receives width, height, step and pixel data of the frame.
+   * @param[out] stamp  the stamp the frame was grabbed with.
+   * @param[in]  flush  if true, the oldest frame is returned even if the ring is not full yet.
+   *
+   * @returns false if no frame is due.
+   */
+  bool retrieve(sensor_msgs::Image& image, ros::Time& stamp, bool flush = false);
+
+  /** @brief Returns true if at least one grabbed frame has not been retrieved yet. */
+  bool hasPendingFrames() const { return pending_frames_ > 0; }
+
+  /** @brief Number of frames overwritten before they could be retrieved. */
+  unsigned long getDroppedFrames() const { return dropped_frames_; }
+
+  /** @brief Deletes the GL buffers. */
+  void release();
+
+private:
+  struct Slot
+  {
+    Slot() : buffer(0), capacity(0), width(0), height(0), format(BGR8), bottom_up(false), pending(false) {}
+
+    unsigned int buffer;    ///< GL name of the pixel buffer object.
+    size_t capacity;        ///< Allocated size of the buffer in bytes.
+    unsigned int width;
+    unsigned int height;
+    Format format;
+    ros::Time stamp;
+    bool bottom_up;         ///< True if the rows were read bottom row first.
+    bool pending;           ///< True while the buffer holds a frame which was not retrieved.
+  };
+
+  /** @brief Returns the slot to write the next frame into, with its buffer bound as pixel pack buffer. */
+  Slot& beginTransfer(unsigned int width, unsigned int height, Format format);
+
+  /** @brief Unbinds the buffer and marks the slot as pending. */
+  void endTransfer(Slot& slot, unsigned int width, unsigned int height, Format format, const ros::Time& stamp,
+                   bool bottom_up);
+
+  std::vector<Slot> slots_;
+  unsigned int write_index_;
+  unsigned int read_index_;
+  unsigned int pending_frames_;
+  unsigned long dropped_frames_;
+  int previous_pack_alignment_;   ///< Restored by endTransfer().
+};
+
+}  // namespace rviz_animated_view_controller
+
+#endif // RVIZ_ANIMATED_VIEW_CONTROLLER_PBO_FRAME_GRABBER_H
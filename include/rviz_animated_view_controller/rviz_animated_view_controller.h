@@ -32,7 +32,7 @@
 #ifndef RVIZ_ANIMATED_VIEW_CONTROLLER_H
 #define RVIZ_ANIMATED_VIEW_CONTROLLER_H
 
-#include <boost/circular_buffer.hpp>
+#include <boost/lockfree/spsc_queue.hpp>
 
 #include <cv_bridge/cv_bridge.h>
 
@@ -44,11 +44,15 @@
 
 #include <ros/subscriber.h>
 #include <ros/ros.h>
+#include <ros/callback_queue.h>
+#include <ros/spinner.h>
 
 #include <geometry_msgs/Pose.h>
 
 #include <std_msgs/Bool.h>
 #include <std_msgs/Duration.h>
+#include <std_msgs/String.h>
+#include <std_msgs/UInt32.h>
 
 #include <view_controller_msgs/CameraMovement.h>
 #include <view_controller_msgs/CameraPlacement.h>
@@ -58,16 +62,42 @@
 #include <OGRE/OgreVector3.h>
 #include <OGRE/OgreQuaternion.h>
 
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+
+#include "rviz_animated_view_controller/attached_frame_history.h"
+#include "rviz_animated_view_controller/batch_view.h"
+#include "rviz_animated_view_controller/camera_command.h"
+#include "rviz_animated_view_controller/compiled_trajectory.h"
+#include "rviz_animated_view_controller/easing.h"
+#include "rviz_animated_view_controller/image_buffer_pool.h"
+#include "rviz_animated_view_controller/image_resample_pass.h"
+#include "rviz_animated_view_controller/image_publish_worker.h"
+#include "rviz_animated_view_controller/nv12_conversion_pass.h"
+#include "rviz_animated_view_controller/offscreen_render_target.h"
+#include "rviz_animated_view_controller/output_manager.h"
+#include "rviz_animated_view_controller/pbo_frame_grabber.h"
+#include "rviz_animated_view_controller/timing_statistics.h"
+#include "rviz_animated_view_controller/trajectory_library.h"
+#include "rviz_animated_view_controller/trajectory_preview.h"
+#include "rviz_animated_view_controller/transform_cache.h"
+#include "rviz_animated_view_controller/video_recorder.h"
+
 namespace rviz {
   class SceneNode;
   class Shape;
   class BoolProperty;
+  class EnumProperty;
   class FloatProperty;
+  class IntProperty;
   class VectorProperty;
   class QuaternionProperty;
   class TfFrameProperty;
   class EditableEnumProperty;
   class RosTopicProperty;
+  class StringProperty;
 }
 
 namespace rviz_animated_view_controller
@@ -80,34 +110,23 @@ Q_OBJECT
 public:
 
   enum { TRANSITION_LINEAR = 0,
-         TRANSITION_SPHERICAL};
+         TRANSITION_SPHERICAL,
+         TRANSITION_SPLINE};
 
-  struct OgreCameraMovement
-  {
-    OgreCameraMovement(){};
-
-    OgreCameraMovement(const Ogre::Vector3& eye,
-                       const Ogre::Vector3& focus,
-                       const Ogre::Vector3& up,
-                       const ros::Duration& transition_duration,
-                       const uint8_t interpolation_speed)
-      : eye(eye)
-        , focus(focus)
-        , up(up)
-        , transition_duration(transition_duration)
-        , interpolation_speed(interpolation_speed)
-    {
-    }
+  enum { CAPTURE_SYNCHRONOUS = 0,
+         CAPTURE_ASYNC_PIPELINED};
 
-    Ogre::Vector3 eye;
-    Ogre::Vector3 focus;
-    Ogre::Vector3 up;
+  enum { IMAGE_ENCODING_BGR8 = 0,
+         IMAGE_ENCODING_NV12};
 
-    ros::Duration transition_duration;
-    uint8_t interpolation_speed;
-  };
+  enum { VIEW_IMAGE_STREAM = 0,   ///< /rviz/view_image
+         PREVIEW_IMAGE_STREAM,    ///< /rviz/view_image_preview
+         CONTACT_SHEET_STREAM,    ///< /rviz/preview_contact_sheet
+         BATCH_VIEW_STREAM};      ///< /rviz/batch_view_<i>/view_image is stream BATCH_VIEW_STREAM + i.
 
-  typedef boost::circular_buffer<OgreCameraMovement> BufferCamMovements;
+  enum ClockSource { CLOCK_WALL = 0,        ///< Trajectories play in real time.
+                     CLOCK_ROS,             ///< Trajectories follow ros::Time, i.e. /clock of a bag or simulation.
+                     CLOCK_FRAME_LOCKED};   ///< Every update renders the next frame at a fixed frame rate.
 
   AnimatedViewController();
   virtual ~AnimatedViewController();
@@ -141,7 +160,9 @@ public:
 
   virtual void handleMouseEvent(rviz::ViewportMouseEvent& evt);
 
-  /** @brief Publishes the current camera pose. */
+  /** @brief Publishes the current camera pose if it changed, at most at the Max Pose Rate.
+   *
+   * A pose which is held back by the rate limit is published by a later update(). */
   void publishCameraPose();
   
   /** @brief Calls beginNewTransition() to
@@ -195,33 +216,171 @@ protected Q_SLOTS:
   /** @brief Called when up vector property is changed (does nothing for now...). */
   virtual void onUpPropertyChanged();
 
+  /** @brief Parses the Bezier Easing property into bezier_easing_. */
+  void onBezierEasingChanged();
+
+  /** @brief Shows or hides the path of the previewed trajectory. */
+  void onTrajectoryPreviewChanged();
+
+  /** @brief Applies the directory and capacity properties to the trajectory_library_. */
+  void onTrajectoryLibraryChanged();
+
+  /** @brief Switches offscreen rendering on and locks it while rendering offscreen only. */
+  void onOffscreenOnlyChanged();
+
 protected:  //methods
+  /** @brief Returns the render window of the render panel, or nullptr if there is none. */
+  Ogre::RenderWindow* getRenderWindow() const;
+
+  /** @brief Returns true if view images are only rendered into the offscreen targets, without the render panel. */
+  bool isOffscreenOnly() const;
+
+  /** @brief Returns the background colour of the render panel, or the last one seen if there is no panel. */
+  Ogre::ColourValue getBackgroundColour();
+
+  /** @brief Mirrors the render window size into the window size properties. */
   void updateWindowSizeProperties();
 
+  /** @brief Sets the geometry of the pooled view images to the window, offscreen, region of interest or
+   * resampled size.
+   *
+   * The images of view_image_pool_ are only reallocated if the size changed. */
+  void configureViewImagePool();
+
+  /** @brief Renders the camera into offscreen_render_target_, (re)creating it if the offscreen size changed.
+   *
+   * The passes the requested images need run on the rendered frame right away: cropping and downscaling, the
+   * NV12 conversion and the preview.
+   *
+   * @param[in] view_image     true if the image for /rviz/view_image is needed.
+   * @param[in] preview_image  true if the image for /rviz/view_image_preview is needed.
+   */
+  void renderOffscreenViewImage(bool view_image, bool preview_image);
+
+  /** @brief Returns true if view images are converted to NV12 on the GPU, which needs offscreen rendering. */
+  bool isNv12ViewImage() const;
+
+  /** @brief Returns true if view images are cropped or downscaled on the GPU, which needs offscreen rendering. */
+  bool isResampledViewImage() const;
+
+  /** @brief Returns true if preview images are produced, which needs offscreen rendering. */
+  bool isPreviewImage() const;
+
+  /** @brief Computes the region of interest of an image of the given size.
+   *
+   * @param[in]  image_width   width of the rendered image.
+   * @param[in]  image_height  height of the rendered image.
+   * @param[out] x             left column of the region.
+   * @param[out] y             top row of the region.
+   * @param[out] width         width of the region, clamped to the image.
+   * @param[out] height        height of the region, clamped to the image.
+   *
+   * @returns false if the Region Of Interest is disabled; the region is the whole image then.
+   */
+  bool getRegionOfInterest(unsigned int image_width, unsigned int image_height,
+                           unsigned int& x, unsigned int& y, unsigned int& width, unsigned int& height) const;
+
+  /** @brief Skips redrawing the visible render panel according to the Panel Frame Skip property
+   * while view images are rendered offscreen during an animation, and entirely while rendering offscreen only. */
+  void throttleRenderPanel();
+
   /** @brief Called at 30Hz by ViewManager::update() while this view
    * is active. Override with code that needs to run repeatedly. */
   virtual void update(float dt, float ros_dt);
 
-  /** @brief Pauses the animation if pause_animation_duration_ is larger than zero.
+  /** @brief Advances the current animation by one step: moves the camera, publishes its pose and the view image.
    *
-   * Adds the pause_animation_duration_ to the transition_start_time_ to continue the animation from
-   * where it was paused.
+   * @returns false if the frame was not rendered because it waits for the transform of the attached frame.
    */
-  void pauseAnimationOnRequest();
+  bool updateAnimation();
 
-  /** @brief Returns true if buffer contains at least one start and end pose needed for one movement. */
-  bool isMovementAvailable(){ return cam_movements_buffer_.size() >= 2; };
+  /** @brief Moves the attached frame to its pose at @a stamp if TF Lookahead is enabled.
+   *
+   * Frame-by-frame renders with Wait For Transform poll TF without blocking for the transform at exactly @a stamp;
+   * everything else interpolates or extrapolates the attached_frame_history_.
+   *
+   * @returns false if the frame should wait for the transform and be rendered by a later update().
+   */
+  bool updateReferencePose(const ros::Time& stamp);
 
-  /** @brief Computes the fraction of time we already used for the current movement. 
-   * 
-   * If we are rendering frame by frame we compute the passed time counting the frames we already rendered.
-   * Dividing by the total number of frames we want to render for the current transition results in the progress.
-   * 
-   * @params[in] transition_duration    total duration of the current movement.
-   * 
-   * @returns Relative progress in time as a float between 0 and 1.
+  /** @brief Looks up the attached frame in the fixed frame through the TF buffer, at @a time or the latest if zero.
+   *
+   * @param[out] stamp  stamp of the transform found.
+   *
+   * @returns false if the transform is not available.
    */
-  double computeRelativeProgressInTime(const ros::Duration& transition_duration);
+  bool lookupAttachedFrame(const ros::Time& time, ros::Time& stamp, Ogre::Vector3& position,
+                           Ogre::Quaternion& orientation);
+
+  /** @brief Renders frame-by-frame animation steps back to back until the time slice is used up.
+   *
+   * Used in the Fast Offline Render mode, where the frame rate is only limited by rendering, readback and
+   * publishing instead of the rate at which ViewManager calls update(). */
+  void renderFramesOffline();
+
+  /** @brief Logs and displays the achieved frame rate of the finished frame-by-frame render. */
+  void reportFrameByFrameThroughput();
+
+  /** @brief Starts recording the frame-by-frame render into a new video file if Record Video is enabled. */
+  void startVideoRecording();
+
+  /** @brief Publishes the timing statistics and frame drop counters if enabled and the period passed. */
+  void publishStatistics();
+
+  /** @brief Returns true while a frame-by-frame render has to wait for view images to be acknowledged.
+   *
+   * With Wait For Acknowledgements enabled, at most Credit Window view images may be unacknowledged. Once the
+   * window is full, frames still in the capture pipeline are flushed so they can be acknowledged; after the Timeout
+   * the render continues without the missing acknowledgements.
+   */
+  bool waitForAcknowledgements();
+
+  /** @brief Resumes a timed pause once it expired.
+   *
+   * While paused, update() keeps rendering and rviz keeps servicing callbacks, only the trajectory clock stops.
+   *
+   * @returns true if the animation is (still) paused.
+   */
+  bool updatePauseState();
+
+  /** @brief Stops the trajectory clock until resumeAnimation() is called or the timed pause expires. */
+  void pauseAnimation();
+
+  /** @brief Continues the animation from where it was paused by shifting the trajectory_start_time_. */
+  void resumeAnimation();
+
+  /** @brief Jumps to a point in time of the remaining trajectory.
+   *
+   * Seeking beyond the end finishes the trajectory.
+   *
+   * @param[in] trajectory_time  time since the start of the trajectory.
+   */
+  void seekAnimation(const ros::Duration& trajectory_time);
+
+  /** @brief Returns true if the trajectory contains at least one start and end pose needed for one movement. */
+  bool isMovementAvailable(){ return trajectory_.hasMovement(); };
+
+  /** @brief Computes the time since the start of the trajectory at which the current frame is rendered.
+   *
+   * If we are rendering frame by frame or the trajectory clock is frame locked we compute the passed time counting
+   * the frames we already rendered, otherwise it is the wall or ROS time passed since the trajectory started.
+   *
+   * @returns Trajectory time in seconds.
+   */
+  double computeTrajectoryTime();
+
+  /** @brief Returns the current time of the trajectory clock; ROS time for CLOCK_ROS, wall time otherwise. */
+  ros::Time getClockTime() const;
+
+  /** @brief Frame rate of frame-by-frame renders, or the Frame Rate of the Frame Locked clock. */
+  int getFrameRate() const;
+
+  /** @brief Returns the stamp of the images showing the trajectory at @a trajectory_time.
+   *
+   * With the ROS clock this is the ROS time the trajectory was sampled at, frame counted trajectories are
+   * stamped in exact steps of the frame period from their start, so replays produce identical stamps.
+   */
+  ros::Time computeSampleStamp(double trajectory_time) const;
   
   /** @brief Convert the relative progress in time to the corresponding relative progress in space wrt. the interpolation speed profile.
    *
@@ -238,6 +397,10 @@ protected:  //methods
    * DECLINING = 1 # Speed of the camera declines smoothly - resembles the second quarter of a sinus wave.
    * FULL      = 2 # Camera is always at full speed - depending on transition_duration.
    * WAVE      = 3 # RISING and DECLINING concatenated in one movement.
+   * CUBIC     = 4 # Smoothstep, like WAVE but polynomial.
+   * QUINTIC   = 5 # Smootherstep, also starts and stops without jerk.
+   * BEZIER    = 6 # The curve of the Bezier Easing property.
+   * See easing.h, evaluateEasing() evaluates whole arrays of samples.
    * 
    * @params[in] relative_progress_in_time  the relative progress in time, between 0 and 1.
    * @params[in] interpolation_speed        speed profile.
@@ -247,17 +410,46 @@ protected:  //methods
   float computeRelativeProgressInSpace(double relative_progress_in_time,
                                        uint8_t interpolation_speed);
 
-  /** @brief Publish the rendered image that is visible to the user in rviz. */
-  void publishViewImage();
+  /** @brief Publish the rendered image that is visible to the user in rviz, and its preview, if subscribed.
+   *
+   * @param[in] stamp  stamp of the published images, see computeSampleStamp().
+   */
+  void publishViewImage(const ros::Time& stamp);
+
+  /** @brief Publishes view images outside of animations at the Stream Rate while Stream Continuously is enabled
+   * and someone subscribed to them. Frames still in the capture pipeline are flushed once streaming stops. */
+  void streamViewImages();
 
-  /** @brief Get the current image rviz is showing as an Ogre::PixelBox. */
-  void getViewImage(std::shared_ptr<Ogre::PixelBox>& pixel_box);
+  /** @brief Reads back and publishes the image for /rviz/view_image, synchronously or through the PBO ring. */
+  void captureViewImage(const ros::Time& stamp);
 
-  void convertImage(std::shared_ptr<Ogre::PixelBox> input_image,
-                    sensor_msgs::ImagePtr output_image);
-  
-  /** @brief Updates the transition_start_time_ and resets the rendered_frames_counter_ for next movement. */
-  void prepareNextMovement(const ros::Duration& previous_transition_duration);
+  /** @brief Reads back and publishes the image for /rviz/view_image_preview, synchronously or through its PBO ring. */
+  void capturePreviewImage(const ros::Time& stamp);
+
+  /** @brief Reads the current image rviz is showing, or the offscreen image, straight into the pixel data of @a image.
+   *
+   * @param[in,out] image  a pooled image whose geometry matches the render window or offscreen target.
+   */
+  void getViewImage(sensor_msgs::Image& image);
+
+  /** @brief Starts an asynchronous readback of the current image rviz is showing, or the offscreen image,
+   * into the PBO ring. */
+  void grabViewImageAsync(const ros::Time& stamp);
+
+  /** @brief Publishes the frames of the view image and preview PBO rings whose readback is due.
+   *
+   * @param[in] flush  if true, all pending frames are published, e.g. at the end of an animation.
+   */
+  void publishPendingViewImages(bool flush);
+
+  /** @brief Publishes the frames of one PBO ring whose readback is due, read into images of @a pool. */
+  void publishPendingFrames(PboFrameGrabber& frame_grabber, ImageBufferPool& pool, unsigned int stream, bool flush);
+
+  /** @brief Hands a captured image to the publish worker, which stamps and publishes it off the render thread.
+   *
+   * View images are numbered in header.seq and, while acknowledgements are awaited, recorded as in flight. */
+  void pushViewImage(const sensor_msgs::ImagePtr& image, const ros::Time& stamp,
+                     unsigned int stream = VIEW_IMAGE_STREAM);
   
   /** @brief Convenience function; connects the signals/slots for position properties. */
   void connectPositionProperties();
@@ -271,32 +463,81 @@ protected:  //methods
   virtual void onAttachedFrameChanged( const Ogre::Vector3& old_reference_position, const Ogre::Quaternion& old_reference_orientation );
 
   /** @brief Update the position of the attached_scene_node_ from the TF
-   * frame specified in the Attached Frame property. */
+   * frame specified in the Attached Frame property, and record it in the attached_frame_history_. */
   void updateAttachedSceneNode();
 
+  /** @brief Queues the camera movement of an incoming CameraPlacement. Runs on the callback spinner.
+   *
+   * @param[in] cp_ptr  incoming CameraPlacement msg.
+   */
   void cameraPlacementCallback(const view_controller_msgs::CameraPlacementConstPtr &cp_ptr);
   
   /** @brief Initiate camera motion from incoming CameraTrajectory.
+   *
+   * Runs on the callback spinner: the movements are transformed into the attached frame here and handed over to
+   * update() as a single command.
    *
    * @param[in] ct_ptr  incoming CameraTrajectory msg.
    */
   void cameraTrajectoryCallback(const view_controller_msgs::CameraTrajectoryConstPtr& ct_ptr);
+
+  /** @brief Queues the movements of a CameraTrajectory for the batch view @a view. Runs on the callback spinner.
+   *
+   * Only the movements are used, the batch views share the attached frame and play mode of the main view.
+   */
+  void batchTrajectoryCallback(unsigned int view, const view_controller_msgs::CameraTrajectoryConstPtr& ct_ptr);
+
+  /** @brief Transforms a CameraTrajectory into the library, publishing its ID. Runs on the callback spinner. */
+  void storeTrajectoryCallback(const view_controller_msgs::CameraTrajectoryConstPtr& ct_ptr);
+
+  /** @brief Queues the stored trajectory with the given ID for playback. Runs on the callback spinner. */
+  void playTrajectoryCallback(const std_msgs::String::ConstPtr& id_msg);
+
+  /** @brief Records the sequence number of the latest view image a recorder received. Runs on the callback spinner. */
+  void viewImageAckCallback(const std_msgs::UInt32::ConstPtr& ack_msg);
+
+  /** @brief Queues the movements of a CameraTrajectory for streamed playback. Runs on the callback spinner. */
+  void streamTrajectoryCallback(const view_controller_msgs::CameraTrajectoryConstPtr& ct_ptr);
+
+  /** @brief Fills a MOVE command with the control parameters and the transformed movements of @a ct. */
+  void convertCameraTrajectory(view_controller_msgs::CameraTrajectory& ct, CameraCommand& command);
+
+  /** @brief Queues a CameraTrajectory to be previewed instead of played. Runs on the callback spinner. */
+  void previewTrajectoryCallback(const view_controller_msgs::CameraTrajectoryConstPtr& ct_ptr);
+
+  /** @brief Transforms the movements of @a ct into the attached frame, skipping those with negative durations. */
+  void convertCameraMovements(view_controller_msgs::CameraTrajectory& ct, TransformCache& transform_cache,
+                              std::vector<OgreCameraMovement>& movements);
   
-  /** @brief Sets the duration the rendering has to wait for during the next update cycle.
+  /** @brief Pauses the animation for the given duration, without blocking the rendering.
    *
-   * @params[in] pause_duration_msg  duration to wait for.
+   * @params[in] pause_duration_msg  duration to pause for.
    */
   void pauseAnimationCallback(const std_msgs::Duration::ConstPtr& pause_duration_msg);
 
+  /** @brief Pauses the animation until further notice if true, resumes it if false.
+   *
+   * @params[in] pause_msg  true to pause, false to resume.
+   */
+  void pauseResumeAnimationCallback(const std_msgs::Bool::ConstPtr& pause_msg);
+
+  /** @brief Seeks the animation, see seekAnimation().
+   *
+   * @params[in] seek_msg  time since the start of the trajectory.
+   */
+  void seekAnimationCallback(const std_msgs::Duration::ConstPtr& seek_msg);
+
   /** @brief Transforms the camera defined by eye, focus and up into the attached frame.
    *
    * @param[in,out] eye     position of the camera.
    * @param[in,out] focus   focus point of the camera.
    * @param[in,out] up      vector pointing up from the camera.
+   * @param[in] transform_cache  transforms resolved for the current message.
    */
   void transformCameraToAttachedFrame(geometry_msgs::PointStamped& eye,
                                       geometry_msgs::PointStamped& focus,
-                                      geometry_msgs::Vector3Stamped& up);
+                                      geometry_msgs::Vector3Stamped& up,
+                                      TransformCache& transform_cache);
   
   //void setUpVectorPropertyModeDependent( const Ogre::Vector3 &vector );
 
@@ -319,9 +560,121 @@ protected:  //methods
   /** @brief Cancels any currently active camera movement. */
   void cancelTransition();
 
-  /** @brief Updates the Ogre camera properties from the view controller properties. */
+  /** @brief Hands a command prepared by a subscriber callback over to update().
+   *
+   * Lock-free, but only the single callback spinner thread may call it. If camera_commands_ is full, PAUSE, RESUME
+   * and SEEK go into overflow_camera_commands_ instead, all other commands are dropped until update() emptied it,
+   * so the control commands are never lost and keep their order. */
+  void queueCameraCommand(CameraCommand&& command);
+
+  /** @brief Applies all commands queued since the last update() on the render thread, overflowed ones last. */
+  void applyCameraCommands();
+
+  /** @brief Applies the commands in camera_commands_. */
+  void applyQueuedCameraCommands();
+
+  void applyCameraCommand(const CameraCommand& command);
+
+  /** @brief Applies the control parameters of a MOVE command and appends its movements to the trajectory. */
+  void applyCameraMovements(const CameraCommand& command);
+
+  /** @brief Applies a STREAM command like a MOVE command, to a trajectory bounded to the Stream Capacity.
+   *
+   * The bound is set when the streamed trajectory starts and lifted when it ends. Movements that do not fit into the
+   * trajectory are dropped and counted, the producer is expected to follow /rviz/stream_buffer_level.
+   */
+  void applyStreamMovements(const CameraCommand& command);
+
+  /** @brief Publishes the number of streamed keyframes waiting to be played if it changed. */
+  void publishStreamBufferLevel();
+
+  /** @brief Appends the movements of a BATCH_MOVE command to the trajectory of its batch view.
+   *
+   * A batch trajectory starts from the pose its view showed last, at the current time of the main trajectory.
+   */
+  void applyBatchMovements(const CameraCommand& command);
+
+  /** @brief Previews the movements of a PREVIEW command without touching the animation.
+   *
+   * The movements are compiled into a trajectory of their own, starting from the current pose. Its eye and focus
+   * paths are drawn and, if subscribed, a contact sheet of frames sampled evenly across its duration is rendered
+   * and published on /rviz/preview_contact_sheet.
+   */
+  void applyTrajectoryPreview(const CameraCommand& command);
+
+  /** @brief Creates or destroys batch views, with their topics, to match the Batch Views property. */
+  void updateBatchViews();
+
+  /** @brief Renders, reads back and publishes all batch views that received a trajectory.
+   *
+   * @param[in] trajectory_time  time of the main trajectory the views are sampled at.
+   * @param[in] stamp            stamp of the frame, shared with the main view image.
+   */
+  void renderBatchViews(double trajectory_time, const ros::Time& stamp);
+
+  /** @brief Interpolates @a trajectory at @a time with the selected Transition Mode.
+   *
+   * @param[out] movement  the movement played at @a time, see CompiledTrajectory::sample().
+   *
+   * @returns false if @a time lies beyond the end of the trajectory, the final pose is returned then.
+   */
+  bool sampleTrajectory(CompiledTrajectory& trajectory, double time, size_t& movement, Ogre::Vector3& eye,
+                        Ogre::Vector3& focus, Ogre::Vector3& up);
+
+  /** @brief Samples @a trajectory at the ascending sample_times_ into sample_movements_ and sample_progress_.
+   *
+   * The speed profile is evaluated with one evaluateEasing() call per run of samples in the same movement, the
+   * poses are then interpolated with interpolateTrajectory().
+   */
+  void sampleTrajectory(CompiledTrajectory& trajectory);
+
+  /** @brief Interpolates @a movement of @a trajectory at @a relative_progress_in_space with the selected
+   * Transition Mode. */
+  void interpolateTrajectory(const CompiledTrajectory& trajectory, size_t movement, float relative_progress_in_space,
+                             Ogre::Vector3& eye, Ogre::Vector3& focus, Ogre::Vector3& up);
+
+  /** @brief Sets the depth and overflow policy of the publish queue for the images of the current frame. */
+  void configurePublishQueue();
+
+  /** @brief Publishes the attached frame and its pose for the subscriber callbacks, if they changed. */
+  void updateAttachedFrameSnapshot();
+
+  /** @brief Creates the transform cache a subscriber callback resolves its message with.
+   *
+   * @param[in] target_frame  frame the message asks the camera to be attached to, empty to keep the current one.
+   */
+  TransformCache makeTransformCache(const std::string& target_frame);
+
+  /** @brief Updates the Ogre camera properties from the view controller properties, or from the animated
+   * camera state while an animation is running. */
   void updateCamera();
 
+  /** @brief Pose the camera is shown at: the animated state while animating, the properties otherwise. */
+  struct CameraState
+  {
+    Ogre::Vector3 eye;
+    Ogre::Vector3 focus;
+    Ogre::Vector3 up;
+  };
+
+  CameraState getCameraState() const;
+
+  /** @brief Points the camera to @a state, relative to the attached frame. */
+  void setCameraPose(const CameraState& state);
+
+  /** @brief Samples the sub-frames of the frame at @a trajectory_time into motion_blur_poses_ if Motion Blur is on,
+   * and their times into motion_blur_times_.
+   *
+   * The shutter spans a fraction of the frame interval: 1 / rate for frame-locked and frame-by-frame renders, the
+   * trajectory time since the previous frame for wall or ROS clocked ones. */
+  void sampleMotionBlur(double trajectory_time);
+
+  /** @brief Writes the animated camera state back into the Eye, Focus, Up and Distance properties.
+   *
+   * Every property change emits Qt signals and refreshes the property tree, so during animations this only happens
+   * at the rate of the Property Sync Rate property, when a movement ends and when the animation stops. */
+  void syncPropertiesFromCameraState();
+
   Ogre::Vector3 fixedFrameToAttachedLocal(const Ogre::Vector3 &v) { return reference_orientation_.Inverse()*(v - reference_position_); }
   Ogre::Vector3 attachedLocalToFixedFrame(const Ogre::Vector3 &v) { return reference_position_ + (reference_orientation_*v); }
 
@@ -337,6 +690,27 @@ protected:    //members
 
   ros::NodeHandle nh_;
 
+  // Subscriptions are serviced by a spinner of their own, see initializeSubscribers()
+  ros::NodeHandle callback_nh_;
+  ros::CallbackQueue callback_queue_;
+  std::unique_ptr<ros::AsyncSpinner> callback_spinner_;
+
+  /** @brief The attached frame as seen by the render thread during the last update(). */
+  struct AttachedFrameSnapshot
+  {
+    std::string frame;
+    Ogre::Vector3 position;
+    Ogre::Quaternion orientation;
+  };
+
+  /** Single producer (callback spinner), single consumer (update()), owns the queued commands. */
+  boost::lockfree::spsc_queue<CameraCommand*> camera_commands_;
+  std::atomic<bool> overflowing_camera_commands_;         ///< True while overflow_camera_commands_ is not empty.
+  std::mutex overflow_camera_commands_mutex_;
+  std::vector<CameraCommand> overflow_camera_commands_;   ///< Control commands which did not fit into camera_commands_.
+  std::shared_ptr<const AttachedFrameSnapshot> attached_frame_snapshot_;  ///< Only accessed with std::atomic_load/store.
+  std::shared_ptr<const AttachedFrameSnapshot> published_attached_frame_; ///< Render thread copy of the last snapshot.
+
   rviz::BoolProperty* mouse_enabled_property_;            ///< If True, most user changes to camera state are disabled.
   rviz::EditableEnumProperty* interaction_mode_property_; ///< Select between Orbit or FPS control style.
   rviz::BoolProperty* fixed_up_property_;                 ///< If True, "up" is fixed to ... up.
@@ -346,6 +720,14 @@ protected:    //members
   rviz::VectorProperty* focus_point_property_;            ///< The point around which the camera "orbits".
   rviz::VectorProperty* up_vector_property_;              ///< The up vector for the camera.
   rviz::FloatProperty* default_transition_time_property_; ///< A default time for any animation requests.
+  rviz::EnumProperty* transition_mode_property_;          ///< Interpolation between the poses of a trajectory.
+  rviz::StringProperty* bezier_easing_property_;          ///< Control points of the BEZIER speed profile.
+  CubicBezierEasing bezier_easing_;
+  rviz::FloatProperty* max_pose_rate_property_;           ///< Maximum camera pose publish rate in Hz, 0 for no limit.
+  rviz::FloatProperty* pose_change_epsilon_property_;     ///< Minimum pose change for the pose to be published again.
+  rviz::FloatProperty* property_sync_rate_property_;      ///< Rate in Hz at which animations update the pose properties.
+  rviz::EnumProperty* clock_source_property_;             ///< Clock the trajectories are played back with.
+  rviz::IntProperty* frame_locked_rate_property_;         ///< Frame rate of the Frame Locked clock.
 
   rviz::RosTopicProperty* camera_placement_topic_property_;
   rviz::RosTopicProperty* camera_trajectory_topic_property_;
@@ -354,17 +736,88 @@ protected:    //members
   rviz::FloatProperty* window_height_property_;           ///< The height of the rviz visualization window in pixels.
 
   rviz::BoolProperty* publish_view_images_property_;      ///< If True, the camera view is published as images.
+  rviz::EnumProperty* view_image_capture_mode_property_;  ///< Synchronous readback or pipelined readback through PBOs.
+  rviz::EnumProperty* view_image_encoding_property_;      ///< Encoding of the published view images.
+  rviz::IntProperty* capture_pipeline_depth_property_;    ///< Number of PBOs used by the pipelined capture mode.
+  rviz::IntProperty* publish_queue_depth_property_;       ///< Number of captured images waiting for the publish worker.
+  rviz::EnumProperty* publish_queue_policy_property_;     ///< What to do when the publish queue is full.
+  rviz::BoolProperty* stream_view_images_property_;       ///< If True, view images are published outside of animations too.
+  rviz::FloatProperty* stream_rate_property_;             ///< Maximum rate of the streamed view images in Hz, 0 for no limit.
+  rviz::BoolProperty* publish_statistics_property_;       ///< If True, hot path timings are published.
+  rviz::FloatProperty* statistics_period_property_;       ///< Seconds in between two statistics messages.
+  rviz::BoolProperty* fast_offline_render_property_;      ///< If True, frame-by-frame trajectories are rendered as fast as possible.
+  rviz::IntProperty* offline_time_slice_property_;        ///< Milliseconds of rendering before control returns to rviz.
+  rviz::BoolProperty* offscreen_only_property_;           ///< If True, the render panel is not drawn and frames are rendered offscreen only.
+  rviz::BoolProperty* render_offscreen_property_;         ///< If True, view images are rendered into a texture of their own size.
+  rviz::IntProperty* offscreen_width_property_;           ///< Width of the offscreen view images in pixels.
+  rviz::IntProperty* offscreen_height_property_;          ///< Height of the offscreen view images in pixels.
+  rviz::IntProperty* supersampling_property_;             ///< Factor by which offscreen images are rendered larger and filtered down.
+  rviz::IntProperty* multisampling_property_;             ///< MSAA samples per pixel of offscreen images.
+  rviz::IntProperty* motion_blur_samples_property_;       ///< Sub-frames averaged into every frame of an animation.
+  rviz::FloatProperty* shutter_property_;                 ///< Fraction of the frame interval the sub-frames span.
+  rviz::IntProperty* panel_frame_skip_property_;          ///< Number of frames the render panel is not redrawn while rendering offscreen.
+  rviz::IntProperty* batch_views_property_;               ///< Number of batch views rendered along with the main view.
+  rviz::BoolProperty* region_of_interest_property_;       ///< If True, view images are cropped to the region below.
+  rviz::IntProperty* roi_x_property_;
+  rviz::IntProperty* roi_y_property_;
+  rviz::IntProperty* roi_width_property_;
+  rviz::IntProperty* roi_height_property_;
+  rviz::IntProperty* downscale_property_;                 ///< Factor by which view images are scaled down on the GPU.
+  rviz::BoolProperty* preview_property_;                  ///< If True, a small preview of the view is published as well.
+  rviz::IntProperty* preview_width_property_;
+  rviz::IntProperty* preview_height_property_;
+  rviz::BoolProperty* acknowledge_view_images_property_;  ///< If True, frame-by-frame renders wait for acknowledgements.
+  rviz::IntProperty* credit_window_property_;             ///< Number of view images which may be unacknowledged.
+  rviz::FloatProperty* acknowledgement_timeout_property_; ///< Seconds after which missing acknowledgements are given up.
+  rviz::BoolProperty* record_video_property_;             ///< If True, frame-by-frame renders are encoded into video files.
+  rviz::StringProperty* video_directory_property_;        ///< Directory the video files are written to.
+  rviz::EditableEnumProperty* video_codec_property_;      ///< FFmpeg encoder used for the video files.
+  rviz::FloatProperty* video_bit_rate_property_;          ///< Target bit rate of the video files in Mbit/s.
+  rviz::BoolProperty* trajectory_preview_property_;       ///< If True, the path of the last previewed trajectory is shown.
+  rviz::IntProperty* preview_path_samples_property_;      ///< Number of poses the previewed path is drawn through.
+  rviz::IntProperty* contact_sheet_columns_property_;
+  rviz::IntProperty* contact_sheet_rows_property_;
+  rviz::IntProperty* contact_sheet_tile_width_property_;
+  rviz::IntProperty* contact_sheet_tile_height_property_;
+  rviz::StringProperty* trajectory_directory_property_;   ///< Directory of the on-disk trajectory library, empty for none.
+  rviz::IntProperty* cached_trajectories_property_;       ///< Number of stored trajectories kept in memory.
+  rviz::IntProperty* stream_capacity_property_;           ///< Maximum number of keyframes of a streamed trajectory.
 
   rviz::TfFrameProperty* attached_frame_property_;
+  rviz::BoolProperty* tf_lookahead_property_;             ///< If True, animations look the attached frame up at their sampled time.
+  rviz::IntProperty* tf_history_size_property_;           ///< Number of attached frame transforms kept.
+  rviz::FloatProperty* max_extrapolation_property_;       ///< Seconds the attached frame may be extrapolated.
+  rviz::BoolProperty* wait_for_transform_property_;       ///< If True, frame-by-frame renders wait for the exact transform.
+  rviz::FloatProperty* wait_timeout_property_;            ///< Seconds a frame waits before it falls back to extrapolation.
   Ogre::SceneNode* attached_scene_node_;
 
   Ogre::Quaternion reference_orientation_;    ///< Used to store the orientation of the attached frame relative to <Fixed Frame>
   Ogre::Vector3 reference_position_;          ///< Used to store the position of the attached frame relative to <Fixed Frame>
+  AttachedFrameHistory attached_frame_history_;
+  bool waiting_for_transform_;                ///< True while a frame-by-frame render waits for the attached frame.
+  ros::WallTime transform_wait_start_time_;
 
   // Variables used during animation
   bool animate_;
-  ros::WallTime transition_start_time_;
-  BufferCamMovements cam_movements_buffer_;
+  ClockSource trajectory_clock_;          ///< Clock source, latched when the trajectory starts.
+  ros::Time trajectory_start_time_;       ///< Time of the trajectory clock at which the trajectory time was zero.
+  ros::Time trajectory_start_stamp_;      ///< ROS time when the trajectory started, base of frame counted stamps.
+  CompiledTrajectory trajectory_;
+  bool streaming_trajectory_;             ///< True while trajectory_ is bounded for streaming.
+  unsigned long dropped_stream_keyframes_;  ///< Streamed movements which did not fit into trajectory_.
+  size_t published_stream_buffer_level_;
+  CameraState camera_state_;              ///< Animated pose, ahead of the properties while camera_state_active_.
+  std::vector<CameraState> motion_blur_poses_;  ///< Sub-frames of the next offscreen view image, oldest first.
+  std::vector<double> motion_blur_times_;       ///< Trajectory times of the sub-frames, batch views sample them too.
+  std::vector<CameraState> batch_view_motion_blur_poses_;  ///< Sub-frames of the batch view rendered next.
+  std::vector<double> sample_times_;      ///< Input of the batched sampleTrajectory(), kept to reuse the memory.
+  std::vector<double> sample_relative_times_;
+  std::vector<size_t> sample_movements_;  ///< Output of the batched sampleTrajectory().
+  std::vector<float> sample_progress_;    ///< Output of the batched sampleTrajectory().
+  double motion_blur_frame_time_;         ///< Trajectory time of the previous clocked frame, negative if none.
+  bool camera_state_active_;              ///< True while the camera is driven by camera_state_.
+  size_t last_synced_movement_;           ///< Movement during which the properties were synced last.
+  ros::WallTime last_property_sync_time_;
 
   rviz::Shape* focal_shape_;    ///< A small ellipsoid to show the focus point.
   bool dragging_;         ///< A flag indicating the dragging state of the mouse.
@@ -374,16 +827,73 @@ protected:    //members
   ros::Subscriber placement_subscriber_;
   ros::Subscriber trajectory_subscriber_;
   ros::Subscriber pause_animation_duration_subscriber_;
-
+  ros::Subscriber pause_animation_subscriber_;
+  ros::Subscriber seek_animation_subscriber_;
+  ros::Subscriber preview_trajectory_subscriber_;
+  ros::Subscriber store_trajectory_subscriber_;
+  ros::Subscriber play_trajectory_subscriber_;
+  ros::Subscriber stream_trajectory_subscriber_;
+  ros::Subscriber view_image_ack_subscriber_;
+
+  OutputManager output_manager_;        ///< Declared before the publishers, whose callbacks use it.
   ros::Publisher current_camera_pose_publisher_;
   ros::Publisher finished_animation_publisher_;
+  ros::Publisher statistics_publisher_;
+  ros::Publisher stored_trajectory_publisher_;
+  ros::Publisher stream_buffer_level_publisher_;
   image_transport::Publisher camera_view_image_publisher_;
+  image_transport::Publisher preview_image_publisher_;
+  image_transport::Publisher contact_sheet_publisher_;
+
+  ImageBufferPool view_image_pool_;
+  PboFrameGrabber pbo_frame_grabber_;
+  std::unique_ptr<ImagePublishWorker> image_publish_worker_;
+  OffscreenRenderTarget offscreen_render_target_;
+  Nv12ConversionPass nv12_conversion_pass_;
+  ImageResamplePass view_image_resample_pass_;
+  ImageResamplePass preview_resample_pass_;
+  ImageBufferPool preview_image_pool_;
+  PboFrameGrabber preview_frame_grabber_;
+  VideoRecorder video_recorder_;        ///< Only used on the thread of the image_publish_worker_.
+  std::vector<std::unique_ptr<BatchView>> batch_views_;
+  std::mutex batch_publishers_mutex_;   ///< Guards resizing batch_image_publishers_ against the publish worker.
+  std::vector<image_transport::Publisher> batch_image_publishers_;
+  std::unique_ptr<TrajectoryPreview> trajectory_preview_;
+  TrajectoryLibrary trajectory_library_;
+  bool recording_video_;                ///< True while the current frame-by-frame render is recorded.
+  bool streaming_view_images_;          ///< True while view images are streamed outside of animations.
+  ros::WallTime last_stream_time_;
+
+  bool render_panel_throttled_;
+  unsigned int render_panel_frame_counter_;
+  Ogre::ColourValue background_colour_;   ///< Background of the render panel, kept for rendering without it.
 
   bool render_frame_by_frame_;
   int target_fps_;
-  int rendered_frames_counter_;
-
-  ros::WallDuration pause_animation_duration_;
+  int rendered_frames_counter_;           ///< Frames rendered since the start of the trajectory.
+  unsigned long rendered_frames_total_;     ///< Frames rendered since the frame-by-frame render started.
+  ros::WallTime frame_by_frame_start_time_;
+  uint32_t view_image_seq_;                          ///< header.seq of the latest view image, counts on across renders.
+  std::atomic<uint32_t> acknowledged_view_image_;    ///< Sequence number of the latest acknowledged view image.
+  std::deque<uint32_t> unacknowledged_view_images_;  ///< Sequence numbers of the unacknowledged view images.
+  bool waiting_for_acknowledgement_;
+  ros::WallTime acknowledgement_wait_start_time_;
+
+  TimingStatistics timing_statistics_;
+  ros::WallTime last_statistics_time_;
+  unsigned long view_image_allocations_at_start_;   ///< Pool allocations when the frame-by-frame render started.
+
+  bool animation_paused_;
+
+  // Gating of the camera pose publisher
+  bool camera_pose_published_;              ///< True once a pose was published, the last_published_* are valid.
+  bool camera_pose_pending_;                ///< True if a changed pose was held back by the rate limit.
+  ros::WallTime last_pose_publish_time_;
+  Ogre::Vector3 last_published_position_;
+  Ogre::Quaternion last_published_orientation_;
+  std::string last_published_frame_id_;
+  ros::Time pause_start_time_;              ///< Time of the trajectory clock when the animation was paused.
+  ros::Time pause_end_time_;                ///< End of a timed pause, zero if paused until resumed.
 };
 
 }  // namespace rviz_animated_view_controller
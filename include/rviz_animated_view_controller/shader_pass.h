@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2012, Willow Garage, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Willow Garage, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef RVIZ_ANIMATED_VIEW_CONTROLLER_SHADER_PASS_H
+#define RVIZ_ANIMATED_VIEW_CONTROLLER_SHADER_PASS_H
+
+#include <functional>
+#include <string>
+
+namespace rviz_animated_view_controller
+{
+
+/** @brief Renders a texture through a fragment shader into a texture of its own, without going through Ogre.
+ *
+ * The fragment shader is drawn once for every pixel of the target and samples the source texture, bound with
+ * bilinear filtering to the uniform "source". Textures are top row first, as Ogre renders into them, and so is the
+ * target. The GL state Ogre relies on is restored after each run.
+ *
+ * All methods must be called from the thread owning the Ogre GL context.
+ */
+class ShaderPass
+{
+public:
+  enum Format { RGB8,     ///< Read back as BGR.
+                R8,       ///< Single channel.
+                RGB16F};  ///< Half float, e.g. to average many images without banding. Read back as BGR bytes.
+
+  typedef std::function<void(unsigned int program)> UniformSetter;
+
+  /**
+   * @param[in] name             used in error messages.
+   * @param[in] fragment_shader  GLSL 1.20 source of the fragment shader.
+   * @param[in] format           format of the target texture.
+   */
+  ShaderPass(const std::string& name, const char* fragment_shader, Format format);
+  ~ShaderPass();
+
+  /** @brief Runs the shader, (re)creating the target texture if its size changed.
+   *
+   * @param[in] source_texture_id  GL name of the texture to sample.
+   * @param[in] width              width of the target texture.
+   * @param[in] height             height of the target texture.
+   * @param[in] set_uniforms       sets the uniforms of the shader apart from "source", with the program in use.
+   * @param[in] blend_weight       weight of the result blended into the previous contents of the target, which it
+   *                               replaces at 1.0. The target keeps its contents only while its size is unchanged.
+   *
+   * @returns false if the shader could not be built, in which case hasFailed() returns true from then on.
+   */
+  bool run(unsigned int source_texture_id, unsigned int width, unsigned int height, const UniformSetter& set_uniforms,
+           float blend_weight = 1.0f);
+
+  /** @brief Synchronously reads the whole target texture into @a data, without row padding. */
+  void copyContentsToMemory(void* data);
+
+  unsigned int getTextureId() const { return texture_; }
+  unsigned int getWidth() const { return width_; }
+  unsigned int getHeight() const { return height_; }
+
+  /** @brief Returns true if the shader failed to build. */
+  bool hasFailed() const { return program_failed_; }
+
+  /** @brief Deletes the GL objects. */
+  void release();
+
+private:
+  bool createProgram();
+  void configure(unsigned int width, unsigned int height);
+
+  std::string name_;
+  const char* fragment_shader_;
+  Format format_;
+
+  unsigned int program_;
+  unsigned int framebuffer_;
+  unsigned int texture_;
+  unsigned int width_;
+  unsigned int height_;
+  bool program_failed_;
+};
+
+}  // namespace rviz_animated_view_controller
+
+#endif // RVIZ_ANIMATED_VIEW_CONTROLLER_SHADER_PASS_H
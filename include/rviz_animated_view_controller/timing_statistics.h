@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2012, Willow Garage, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Willow Garage, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef RVIZ_ANIMATED_VIEW_CONTROLLER_TIMING_STATISTICS_H
+#define RVIZ_ANIMATED_VIEW_CONTROLLER_TIMING_STATISTICS_H
+
+#include <diagnostic_msgs/DiagnosticArray.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+namespace rviz_animated_view_controller
+{
+
+/** @brief Rolling duration statistics of the hot paths of the view controller.
+ *
+ * Every section keeps the durations of its last calls in a ring, from which percentiles are computed when the
+ * statistics are exported. While disabled, a ScopedTimer neither reads the clock nor locks, so the instrumentation
+ * can stay in place. record() may be called from any thread.
+ */
+class TimingStatistics
+{
+public:
+  enum Section { UPDATE = 0,
+                 RENDER_OFFSCREEN,
+                 CAPTURE,
+                 PUBLISH,
+                 TRANSFORM,
+                 PLACEMENT_CALLBACK,
+                 TRAJECTORY_CALLBACK,
+                 SECTION_COUNT};
+
+  /** @brief Records the time spent between construction and destruction for a section. */
+  class ScopedTimer
+  {
+  public:
+    ScopedTimer(TimingStatistics& statistics, Section section)
+      : statistics_(statistics.isEnabled() ? &statistics : nullptr)
+        , section_(section)
+    {
+      if(statistics_)
+        start_ = std::chrono::steady_clock::now();
+    }
+
+    ~ScopedTimer()
+    {
+      if(statistics_)
+        statistics_->record(section_, std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count());
+    }
+
+  private:
+    TimingStatistics* statistics_;
+    Section section_;
+    std::chrono::steady_clock::time_point start_;
+  };
+
+  /** @param[in] window_size  number of durations per section the percentiles are computed from. */
+  explicit TimingStatistics(size_t window_size = 1000);
+
+  void setEnabled(bool enabled) { enabled_.store(enabled, std::memory_order_relaxed); }
+  bool isEnabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+  /** @brief Adds the duration of one call of @a section. */
+  void record(Section section, double seconds);
+
+  /** @brief Appends one status per section with call count, p50, p95, p99 and max in milliseconds. */
+  void appendDiagnostics(diagnostic_msgs::DiagnosticArray& diagnostics) const;
+
+  /** @brief Forgets all recorded durations. */
+  void reset();
+
+  static const char* getSectionName(Section section);
+
+private:
+  struct Window
+  {
+    Window() : next(0), count(0), max(0.0) {}
+
+    std::vector<float> durations;
+    size_t next;            ///< Ring index the next duration is written to.
+    unsigned long count;    ///< Calls since the last reset.
+    double max;
+  };
+
+  std::atomic<bool> enabled_;
+  size_t window_size_;
+
+  mutable std::mutex mutex_;
+  std::array<Window, SECTION_COUNT> windows_;
+};
+
+}  // namespace rviz_animated_view_controller
+
+#endif // RVIZ_ANIMATED_VIEW_CONTROLLER_TIMING_STATISTICS_H
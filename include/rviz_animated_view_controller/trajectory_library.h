@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2012, Willow Garage, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Willow Garage, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef RVIZ_ANIMATED_VIEW_CONTROLLER_TRAJECTORY_LIBRARY_H
+#define RVIZ_ANIMATED_VIEW_CONTROLLER_TRAJECTORY_LIBRARY_H
+
+#include "rviz_animated_view_controller/camera_command.h"
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace rviz_animated_view_controller
+{
+
+/** @brief Trajectories which were transformed into the attached frame once, to be played again by their ID.
+ *
+ * A stored trajectory is the MOVE command its CameraTrajectory was converted into, so playing it again skips
+ * deserializing the message and all TF lookups. The ID is a hash of the command, storing the same trajectory twice
+ * yields the same ID. The most recently used trajectories are kept in memory; if a directory is set, every stored
+ * trajectory is also written to <id>.trajectory there and memory-mapped back in when it is not cached, so the
+ * library survives restarts of rviz. The files use the native byte order, they are a cache, not an exchange format.
+ *
+ * All methods are thread-safe.
+ */
+class TrajectoryLibrary
+{
+public:
+  explicit TrajectoryLibrary(size_t capacity = 16);
+
+  /** @brief Changes the number of trajectories kept in memory, dropping the least recently used ones. */
+  void setCapacity(size_t capacity);
+
+  /** @brief Sets the directory of the on-disk storage, empty to keep the trajectories in memory only. */
+  void setDirectory(const std::string& directory);
+
+  /** @brief Stores the movements and control parameters of a MOVE command.
+   *
+   * @returns the ID to play the trajectory with.
+   */
+  std::string store(const CameraCommand& command);
+
+  /** @brief Looks up the trajectory stored as @a id, in memory first and on disk second.
+   *
+   * @returns nullptr if no trajectory with that ID is known.
+   */
+  std::shared_ptr<const CameraCommand> find(const std::string& id);
+
+private:
+  struct Entry
+  {
+    std::shared_ptr<const CameraCommand> command;
+    uint64_t last_use;
+  };
+
+  /** @brief Appends the file representation of @a command to @a buffer. */
+  static void serialize(const CameraCommand& command, std::string& buffer);
+
+  /** @brief Converts a file representation back into a MOVE command, nullptr if it is malformed. */
+  static std::shared_ptr<CameraCommand> deserialize(const char* data, size_t size);
+
+  std::string getFileName(const std::string& id) const;
+
+  std::shared_ptr<CameraCommand> load(const std::string& id) const;
+
+  /** @brief Adds @a command to the cache, evicting the least recently used entries beyond the capacity. */
+  void cache(const std::string& id, const std::shared_ptr<const CameraCommand>& command);
+
+  void evict();
+
+  std::mutex mutex_;
+  std::map<std::string, Entry> entries_;
+  size_t capacity_;
+  std::string directory_;
+  uint64_t use_counter_;
+};
+
+}  // namespace rviz_animated_view_controller
+
+#endif // RVIZ_ANIMATED_VIEW_CONTROLLER_TRAJECTORY_LIBRARY_H
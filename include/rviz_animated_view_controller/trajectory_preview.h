@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2012, Willow Garage, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Willow Garage, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef RVIZ_ANIMATED_VIEW_CONTROLLER_TRAJECTORY_PREVIEW_H
+#define RVIZ_ANIMATED_VIEW_CONTROLLER_TRAJECTORY_PREVIEW_H
+
+#include <sensor_msgs/Image.h>
+
+#include <OGRE/OgreColourValue.h>
+#include <OGRE/OgreQuaternion.h>
+#include <OGRE/OgreVector3.h>
+
+#include "rviz_animated_view_controller/offscreen_render_target.h"
+
+#include <vector>
+
+namespace Ogre
+{
+class Camera;
+class ManualObject;
+class SceneManager;
+class SceneNode;
+}
+
+namespace rviz_animated_view_controller
+{
+
+/** @brief Shows where a trajectory goes without playing it.
+ *
+ * The eye and focus paths are drawn as two line strips of one Ogre::ManualObject, so a path of any length is a
+ * single batch of geometry. A contact sheet renders frames sampled across the whole trajectory into one image with
+ * a camera of its own, independent of the view controller's camera and offscreen target.
+ */
+class TrajectoryPreview
+{
+public:
+  struct Pose
+  {
+    Ogre::Vector3 eye;
+    Ogre::Vector3 focus;
+    Ogre::Vector3 up;
+  };
+
+  /** @brief Creates the path and the camera, both attached to @a attached_scene_node like the main camera. */
+  TrajectoryPreview(Ogre::SceneManager* scene_manager, Ogre::SceneNode* attached_scene_node);
+  ~TrajectoryPreview();
+
+  /** @brief Replaces the drawn path by strips through the eye positions and the focus points of @a poses. */
+  void setPath(const std::vector<Pose>& poses);
+
+  void clearPath();
+
+  void setPathVisible(bool visible);
+
+  /** @brief Renders @a poses into the tiles of a contact sheet, row by row, top left first.
+   *
+   * The path is hidden while the tiles are rendered.
+   *
+   * @param[in]  main_camera            near and far clip distance and field of view are copied from it.
+   * @param[in]  reference_orientation  orientation of the attached frame.
+   * @param[in]  fixed_up               whether the yaw axis of the camera is fixed to the up vector.
+   * @param[out] sheet                  bgr8 image of @a columns tiles per row and as many rows as needed.
+   */
+  void renderContactSheet(const std::vector<Pose>& poses, unsigned int columns, unsigned int tile_width,
+                          unsigned int tile_height, const Ogre::Camera* main_camera,
+                          const Ogre::Quaternion& reference_orientation, bool fixed_up,
+                          const Ogre::ColourValue& background_colour, sensor_msgs::Image& sheet);
+
+  /** @brief Releases the textures of the contact sheet camera. */
+  void release() { render_target_.destroy(); }
+
+private:
+  Ogre::SceneManager* scene_manager_;
+  Ogre::ManualObject* path_;
+  bool path_visible_;
+  Ogre::Camera* camera_;
+  OffscreenRenderTarget render_target_;
+  sensor_msgs::Image tile_;   ///< Kept to reuse its memory for every tile.
+};
+
+}  // namespace rviz_animated_view_controller
+
+#endif // RVIZ_ANIMATED_VIEW_CONTROLLER_TRAJECTORY_PREVIEW_H
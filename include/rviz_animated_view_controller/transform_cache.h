@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2012, Willow Garage, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Willow Garage, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef RVIZ_ANIMATED_VIEW_CONTROLLER_TRANSFORM_CACHE_H
+#define RVIZ_ANIMATED_VIEW_CONTROLLER_TRANSFORM_CACHE_H
+
+#include <OGRE/OgreQuaternion.h>
+#include <OGRE/OgreVector3.h>
+
+#include <map>
+#include <string>
+
+namespace rviz
+{
+class FrameManager;
+}
+
+namespace rviz_animated_view_controller
+{
+
+/** @brief Resolves the latest transforms from message frames into the attached frame once per distinct frame.
+ *
+ * Meant to live for the duration of one message callback: all points of a CameraTrajectory usually share one or
+ * two frames, so the TF lookups shrink from three per movement to a handful per message. Like the lookups it
+ * replaces, it ignores the stamps of the points, a trajectory is always placed relative to the latest transforms.
+ * The frame manager guards its cache with a mutex, so the cache can be used off the render thread. Every cached
+ * transform already contains the inverse of the attached frame pose, so applying it is a single rotation and
+ * translation.
+ */
+class TransformCache
+{
+public:
+  struct Transform
+  {
+    Transform() : rotation(Ogre::Quaternion::IDENTITY), translation(Ogre::Vector3::ZERO) {}
+
+    Ogre::Vector3 transformPoint(const Ogre::Vector3& point) const { return rotation * point + translation; }
+    Ogre::Vector3 transformVector(const Ogre::Vector3& vector) const { return rotation * vector; }
+
+    Ogre::Quaternion rotation;
+    Ogre::Vector3 translation;
+  };
+
+  /** @brief Creates an empty cache.
+   *
+   * @param[in] frame_manager              used for the lookups of frames relative to the fixed frame.
+   * @param[in] attached_frame             name of the attached frame.
+   * @param[in] attached_frame_position    position of the attached frame in the fixed frame.
+   * @param[in] attached_frame_orientation orientation of the attached frame in the fixed frame.
+   */
+  TransformCache(rviz::FrameManager* frame_manager,
+                 const std::string& attached_frame,
+                 const Ogre::Vector3& attached_frame_position,
+                 const Ogre::Quaternion& attached_frame_orientation);
+
+  /** @brief Returns the latest transform from @a frame_id into the attached frame.
+   *
+   * Frames that cannot be resolved are warned about once and treated as the fixed frame.
+   */
+  const Transform& lookup(const std::string& frame_id);
+
+  const std::string& getAttachedFrame() const { return attached_frame_; }
+
+  /** @brief Number of distinct frames looked up in the frame manager. */
+  size_t getResolvedTransforms() const { return transforms_.size(); }
+
+private:
+  rviz::FrameManager* frame_manager_;
+  std::string attached_frame_;
+  Ogre::Vector3 attached_frame_position_;
+  Ogre::Quaternion attached_frame_orientation_inverse_;
+
+  std::map<std::string, Transform> transforms_;
+};
+
+}  // namespace rviz_animated_view_controller
+
+#endif // RVIZ_ANIMATED_VIEW_CONTROLLER_TRANSFORM_CACHE_H
@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2012, Willow Garage, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Willow Garage, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef RVIZ_ANIMATED_VIEW_CONTROLLER_VIDEO_RECORDER_H
+#define RVIZ_ANIMATED_VIEW_CONTROLLER_VIDEO_RECORDER_H
+
+#include <sensor_msgs/Image.h>
+
+#include <string>
+
+struct AVCodec;
+struct AVCodecContext;
+struct AVFormatContext;
+struct AVFrame;
+struct AVPacket;
+struct AVStream;
+struct SwsContext;
+
+namespace rviz_animated_view_controller
+{
+
+/** @brief Encodes view images into a video file in process, through FFmpeg.
+ *
+ * Saves recording long frame-by-frame animations through a separate node, which would receive every uncompressed
+ * image through ROS serialization and a socket. Hardware encoders such as h264_nvenc take NV12 images as they are,
+ * other encoders and input encodings are converted by libswscale.
+ *
+ * Without FFmpeg at build time (HAVE_FFMPEG undefined) start() only reports that recording is unavailable.
+ * The recorder is not thread-safe, all calls have to come from the same thread, e.g. the ImagePublishWorker.
+ */
+class VideoRecorder
+{
+public:
+  struct Options
+  {
+    std::string file_name;      ///< The container format is derived from the extension, e.g. .mp4.
+    std::string codec;          ///< FFmpeg encoder name, falls back to a software H.264 encoder if it cannot be opened.
+    int frames_per_second;
+    long bit_rate;              ///< In bit/s.
+  };
+
+  VideoRecorder();
+
+  /** @brief Finishes a running recording. */
+  ~VideoRecorder();
+
+  /** @brief Returns true if the recorder was built with FFmpeg. */
+  static bool isAvailable();
+
+  /** @brief Prepares a recording. The file is only opened by the first write(), which determines the video size. */
+  void start(const Options& options);
+
+  /** @brief Encodes @a image, a bgr8, rgb8 or nv12 image, as the next frame.
+   *
+   * Images whose size differs from the first one are skipped. An encoder error stops the recording.
+   *
+   * @returns false if the image was not recorded.
+   */
+  bool write(const sensor_msgs::Image& image);
+
+  /** @brief Flushes the encoder and finishes the file. */
+  void stop();
+
+  bool isRecording() const { return recording_; }
+
+  unsigned long getWrittenFrames() const { return written_frames_; }
+
+private:
+  bool open(const sensor_msgs::Image& image);
+
+  /** @brief Creates codec_context_ for images of the given size and opens @a codec with it.
+   *
+   * @returns false and leaves codec_context_ null if the encoder cannot be opened, e.g. NVENC without the hardware.
+   */
+  bool openEncoder(const AVCodec* codec, unsigned int width, unsigned int height, int input_format);
+  bool encode(AVFrame* frame);
+  void close();
+
+  Options options_;
+  bool recording_;
+  unsigned long written_frames_;
+
+  AVFormatContext* format_context_;
+  AVCodecContext* codec_context_;
+  AVStream* stream_;
+  AVFrame* frame_;
+  AVPacket* packet_;
+  SwsContext* sws_context_;
+  int input_format_;            ///< AVPixelFormat of the images written.
+  unsigned int input_width_;
+  unsigned int input_height_;
+};
+
+}  // namespace rviz_animated_view_controller
+
+#endif // RVIZ_ANIMATED_VIEW_CONTROLLER_VIDEO_RECORDER_H
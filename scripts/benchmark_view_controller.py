@@ -0,0 +1,218 @@
+#!/usr/bin/env python
+# Software License Agreement (BSD License)
+#
+# Copyright (c) 2012, Willow Garage, Inc.
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are met:
+#
+#     * Redistributions of source code must retain the above copyright
+#       notice, this list of conditions and the following disclaimer.
+#     * Redistributions in binary form must reproduce the above copyright
+#       notice, this list of conditions and the following disclaimer in the
+#       documentation and/or other materials provided with the distribution.
+#     * Neither the name of the Willow Garage, Inc. nor the names of its
+#       contributors may be used to endorse or promote products derived from
+#       this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+# AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+# ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+# LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+# SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+# INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+# CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+# ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+# POSSIBILITY OF SUCH DAMAGE.
+
+"""Benchmarks the animated view controller of a running rviz instance.
+
+For every keyframe count in ~keyframe_counts a circular frame-by-frame trajectory is sent to rviz and the
+view images coming back are timed. The results are written as JSON to ~output (or stdout) so they can be
+compared across releases:
+
+  ingest_latency_s      time from sending the trajectory until the first camera pose of it is published.
+  publish_fps           view images received per second of the render.
+  first_image_latency_s time from sending the trajectory until the first view image of it is received.
+  capture_latency_s     mean / median / 95th percentile / max of the time between receiving an image and
+                        receiving the previous one (or sending the trajectory, for the first image).
+  image_width/height    resolution of the received images.
+
+The view controller has to be the active view of rviz; capture mode, offscreen resolution and fast offline
+rendering are taken from its properties, so run the benchmark once per configuration of interest.
+
+Frame-by-frame images are stamped with the time of their sample on the trajectory, not with the time they
+were rendered, so the latencies are measured on the clock of this node against its own publish time.
+"""
+
+import json
+import math
+import sys
+import threading
+import time
+
+import rospy
+from geometry_msgs.msg import PoseStamped
+from sensor_msgs.msg import Image
+from std_msgs.msg import Bool
+from view_controller_msgs.msg import CameraMovement, CameraTrajectory
+
+
+def percentile(sorted_values, fraction):
+    if not sorted_values:
+        return None
+    index = min(len(sorted_values) - 1, int(round(fraction * (len(sorted_values) - 1))))
+    return sorted_values[index]
+
+
+class ViewControllerBenchmark(object):
+
+    def __init__(self):
+        self.frame = rospy.get_param('~frame', 'base_link')
+        self.keyframe_counts = rospy.get_param('~keyframe_counts', [10, 100, 1000, 5000])
+        self.trajectory_duration = rospy.get_param('~trajectory_duration', 4.0)
+        self.frames_per_second = rospy.get_param('~frames_per_second', 30)
+        self.timeout = rospy.get_param('~timeout', 120.0)
+        self.output = rospy.get_param('~output', '')
+
+        self.lock = threading.Lock()
+        self.running = False
+        self.send_time = None
+        self.first_pose_time = None
+        self.image_times = []
+        self.latencies = []
+        self.image_size = (0, 0)
+        self.finished = threading.Event()
+
+        self.trajectory_publisher = rospy.Publisher('/rviz/camera_trajectory', CameraTrajectory, queue_size=1)
+        rospy.Subscriber('/rviz/current_camera_pose', PoseStamped, self.pose_callback, queue_size=10)
+        rospy.Subscriber('/rviz/view_image', Image, self.image_callback, queue_size=100, buff_size=2**26)
+        rospy.Subscriber('/rviz/finished_animation', Bool, self.finished_callback, queue_size=1)
+
+    def pose_callback(self, _):
+        with self.lock:
+            if self.running and self.first_pose_time is None:
+                self.first_pose_time = time.time()
+
+    def image_callback(self, image):
+        now = time.time()
+        with self.lock:
+            if not self.running:
+                return
+            previous_time = self.image_times[-1] if self.image_times else self.send_time
+            self.image_times.append(now)
+            self.latencies.append(now - previous_time)
+            self.image_size = (image.width, image.height)
+
+    def finished_callback(self, msg):
+        if msg.data:
+            self.finished.set()
+
+    def make_trajectory(self, keyframe_count):
+        trajectory = CameraTrajectory()
+        trajectory.target_frame = self.frame
+        trajectory.allow_free_yaw_axis = False
+        trajectory.mouse_interaction_mode = CameraTrajectory.NO_CHANGE
+        trajectory.interaction_disabled = True
+        trajectory.render_frame_by_frame = True
+        trajectory.frames_per_second = self.frames_per_second
+
+        transition_duration = rospy.Duration.from_sec(self.trajectory_duration / keyframe_count)
+        for i in range(keyframe_count):
+            angle = 2.0 * math.pi * (i + 1) / keyframe_count
+            movement = CameraMovement()
+            movement.eye.header.frame_id = self.frame
+            movement.eye.point.x = 10.0 * math.cos(angle)
+            movement.eye.point.y = 10.0 * math.sin(angle)
+            movement.eye.point.z = 5.0
+            movement.focus.header.frame_id = self.frame
+            movement.up.header.frame_id = self.frame
+            movement.up.vector.z = 1.0
+            movement.transition_duration = transition_duration
+            movement.interpolation_speed = CameraMovement.FULL
+            trajectory.trajectory.append(movement)
+        return trajectory
+
+    def run_once(self, keyframe_count):
+        trajectory = self.make_trajectory(keyframe_count)
+
+        self.finished.clear()
+        with self.lock:
+            self.running = True
+            self.send_time = time.time()
+            self.first_pose_time = None
+            self.image_times = []
+            self.latencies = []
+            self.image_size = (0, 0)
+            start = self.send_time
+        self.trajectory_publisher.publish(trajectory)
+        completed = self.finished.wait(self.timeout)
+        end = time.time()
+        # images still in transport belong to this run
+        rospy.sleep(0.5)
+
+        with self.lock:
+            self.running = False
+            image_times = list(self.image_times)
+            latencies = sorted(self.latencies)
+            image_size = self.image_size
+            first_pose_time = self.first_pose_time
+
+        result = {
+            'keyframes': keyframe_count,
+            'completed': completed,
+            'expected_frames': int(self.trajectory_duration * self.frames_per_second) + 1,
+            'received_frames': len(image_times),
+            'image_width': image_size[0],
+            'image_height': image_size[1],
+            'render_time_s': end - start,
+            'ingest_latency_s': (first_pose_time - start) if first_pose_time is not None else None,
+            'first_image_latency_s': (image_times[0] - start) if image_times else None,
+            'publish_fps': None,
+            'capture_latency_s': {
+                'mean': sum(latencies) / len(latencies) if latencies else None,
+                'median': percentile(latencies, 0.5),
+                'p95': percentile(latencies, 0.95),
+                'max': latencies[-1] if latencies else None,
+            },
+        }
+        if len(image_times) > 1 and image_times[-1] > image_times[0]:
+            result['publish_fps'] = (len(image_times) - 1) / (image_times[-1] - image_times[0])
+        return result
+
+    def run(self):
+        # give rviz time to connect to the trajectory topic
+        deadline = time.time() + self.timeout
+        while self.trajectory_publisher.get_num_connections() == 0 and time.time() < deadline:
+            if rospy.is_shutdown():
+                return
+            rospy.sleep(0.1)
+
+        results = {
+            'benchmark': 'rviz_animated_view_controller',
+            'stamp': time.time(),
+            'trajectory_duration_s': self.trajectory_duration,
+            'frames_per_second': self.frames_per_second,
+            'runs': [],
+        }
+        for keyframe_count in self.keyframe_counts:
+            if rospy.is_shutdown():
+                break
+            rospy.loginfo('Benchmarking a trajectory of %d keyframes', keyframe_count)
+            results['runs'].append(self.run_once(keyframe_count))
+
+        text = json.dumps(results, indent=2, sort_keys=True)
+        if self.output:
+            with open(self.output, 'w') as output_file:
+                output_file.write(text + '\n')
+            rospy.loginfo('Wrote benchmark results to %s', self.output)
+        else:
+            sys.stdout.write(text + '\n')
+
+
+if __name__ == '__main__':
+    rospy.init_node('benchmark_view_controller')
+    ViewControllerBenchmark().run()
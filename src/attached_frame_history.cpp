@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) 2012, Willow Garage, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Willow Garage, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "rviz_animated_view_controller/attached_frame_history.h"
+
+#include <algorithm>
+
+namespace rviz_animated_view_controller
+{
+
+AttachedFrameHistory::AttachedFrameHistory(size_t capacity)
+  : capacity_(std::max<size_t>(2, capacity))
+{
+}
+
+void AttachedFrameHistory::setCapacity(size_t capacity)
+{
+  capacity_ = std::max<size_t>(2, capacity);
+  while(poses_.size() > capacity_)
+    poses_.pop_front();
+}
+
+void AttachedFrameHistory::setFrames(const std::string& fixed_frame, const std::string& frame)
+{
+  if(fixed_frame == fixed_frame_ && frame == frame_)
+    return;
+
+  fixed_frame_ = fixed_frame;
+  frame_ = frame;
+  poses_.clear();
+}
+
+void AttachedFrameHistory::add(const ros::Time& stamp, const Ogre::Vector3& position,
+                               const Ogre::Quaternion& orientation)
+{
+  // the same latest transform is usually seen by several updates
+  if(!poses_.empty() && stamp <= poses_.back().stamp)
+    return;
+
+  if(poses_.size() >= capacity_)
+    poses_.pop_front();
+
+  Pose pose;
+  pose.stamp = stamp;
+  pose.position = position;
+  pose.orientation = orientation;
+  poses_.push_back(pose);
+}
+
+bool AttachedFrameHistory::lookup(const ros::Time& time, double max_extrapolation, Ogre::Vector3& position,
+                                  Ogre::Quaternion& orientation) const
+{
+  if(poses_.empty())
+    return false;
+
+  if(poses_.size() == 1 || time <= poses_.front().stamp)
+  {
+    position = poses_.front().position;
+    orientation = poses_.front().orientation;
+    return true;
+  }
+
+  // stamps strictly increase, so the interval in between two poses is never empty
+  const Pose* before = nullptr;
+  const Pose* after = nullptr;
+  double t = 0.0;
+  if(time >= poses_.back().stamp)
+  {
+    before = &poses_[poses_.size() - 2];
+    after = &poses_.back();
+    const double extrapolation = std::min(std::max(0.0, max_extrapolation), (time - after->stamp).toSec());
+    t = 1.0 + extrapolation / (after->stamp - before->stamp).toSec();
+  }
+  else
+  {
+    auto next = std::upper_bound(poses_.begin(), poses_.end(), time,
+                                 [](const ros::Time& stamp, const Pose& pose){ return stamp < pose.stamp; });
+    after = &*next;
+    before = &*(next - 1);
+    t = (time - before->stamp).toSec() / (after->stamp - before->stamp).toSec();
+  }
+
+  position = before->position + (after->position - before->position) * static_cast<Ogre::Real>(t);
+  // Slerp extrapolates along the same great circle for t > 1
+  orientation = Ogre::Quaternion::Slerp(static_cast<Ogre::Real>(t), before->orientation, after->orientation, true);
+  orientation.normalise();
+  return true;
+}
+
+}  // namespace rviz_animated_view_controller
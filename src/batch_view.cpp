@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2012, Willow Garage, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Willow Garage, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "rviz_animated_view_controller/batch_view.h"
+
+#include <OGRE/OgreCamera.h>
+#include <OGRE/OgreSceneManager.h>
+#include <OGRE/OgreSceneNode.h>
+
+#include <sstream>
+
+namespace rviz_animated_view_controller
+{
+
+BatchView::BatchView(unsigned int index, Ogre::SceneManager* scene_manager, Ogre::SceneNode* attached_scene_node)
+  : index(index)
+    , scene_manager(scene_manager)
+    , camera(nullptr)
+    , start_time(0.0)
+    , active(false)
+    , eye(Ogre::Vector3::ZERO)
+    , focus(Ogre::Vector3::UNIT_X)
+    , up(Ogre::Vector3::UNIT_Z)
+{
+  // camera names are unique per scene manager, several view controllers may have batch views
+  static unsigned int count = 0;
+  std::stringstream ss;
+  ss << "AnimatedViewControllerBatchView" << count++;
+
+  camera = scene_manager->createCamera(ss.str());
+  camera->setProjectionType(Ogre::PT_PERSPECTIVE);
+  attached_scene_node->attachObject(camera);
+}
+
+BatchView::~BatchView()
+{
+  // the textures hold viewports of the camera
+  render_target.destroy();
+  frame_grabber.release();
+  scene_manager->destroyCamera(camera);
+}
+
+std::string BatchView::getTopicNamespace(unsigned int index)
+{
+  return "/rviz/batch_view_" + std::to_string(index);
+}
+
+void BatchView::updateCamera(const Ogre::Camera* main_camera, const Ogre::Quaternion& reference_orientation,
+                             bool fixed_up)
+{
+  updateCamera(main_camera, reference_orientation, fixed_up, eye, focus, up);
+}
+
+void BatchView::updateCamera(const Ogre::Camera* main_camera, const Ogre::Quaternion& reference_orientation,
+                             bool fixed_up, const Ogre::Vector3& eye, const Ogre::Vector3& focus,
+                             const Ogre::Vector3& up)
+{
+  camera->setNearClipDistance(main_camera->getNearClipDistance());
+  camera->setFarClipDistance(main_camera->getFarClipDistance());
+  camera->setFOVy(main_camera->getFOVy());
+
+  camera->setPosition(eye);
+  camera->setFixedYawAxis(fixed_up, reference_orientation * up);
+  camera->setDirection(reference_orientation * (focus - eye));
+}
+
+}  // namespace rviz_animated_view_controller
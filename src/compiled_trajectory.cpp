@@ -0,0 +1,231 @@
+/*
+ * Copyright (c) 2012, Willow Garage, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Willow Garage, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "rviz_animated_view_controller/compiled_trajectory.h"
+
+#include <algorithm>
+
+namespace rviz_animated_view_controller
+{
+
+// played keyframes of unbounded trajectories are kept a while, so seeking back does not run into the start
+static const size_t DISCARD_THRESHOLD = 1024;
+// slots allocated by the first keyframe of an unbounded trajectory
+static const size_t INITIAL_CAPACITY = 16;
+// lower bound on the time spans the spline tangents are divided by
+static const double MIN_TIME_SPAN = 1e-6;
+
+CompiledTrajectory::CompiledTrajectory()
+  : head_(0)
+    , size_(0)
+    , max_size_(0)
+    , cursor_(1)
+{
+}
+
+void CompiledTrajectory::clear()
+{
+  head_ = 0;
+  size_ = 0;
+  cursor_ = 1;
+}
+
+void CompiledTrajectory::reserve(size_t additional_keyframes)
+{
+  // setMaxSize() allocated all slots of a bounded ring, appending beyond them is refused anyway
+  if(max_size_ > 0 || size_ + additional_keyframes <= keyframes_.size())
+    return;
+
+  // grow geometrically, so many small trajectories appended one after the other copy every keyframe O(1) times
+  reallocate(std::max(size_ + additional_keyframes, 2 * keyframes_.size()));
+}
+
+void CompiledTrajectory::setMaxSize(size_t max_size)
+{
+  max_size_ = max_size;
+  if(max_size_ > keyframes_.size())
+    reallocate(max_size_);
+}
+
+bool CompiledTrajectory::append(const Ogre::Vector3& eye, const Ogre::Vector3& focus, const Ogre::Vector3& up,
+                                double transition_duration, uint8_t interpolation_speed)
+{
+  if(isFull())
+    return false;
+  if(size_ == keyframes_.size())
+    reallocate(std::max(INITIAL_CAPACITY, 2 * keyframes_.size()));
+
+  Keyframe& keyframe = at(size_);
+  keyframe.eye = eye;
+  keyframe.focus = focus;
+  keyframe.up = up;
+  keyframe.end_time = size_ == 0 ? 0.0 : at(size_ - 1).end_time + std::max(0.0, transition_duration);
+  keyframe.interpolation_speed = interpolation_speed;
+
+  size_++;
+  return true;
+}
+
+void CompiledTrajectory::reallocate(size_t capacity)
+{
+  std::vector<Keyframe> keyframes(capacity);
+  for(size_t i = 0; i < size_; ++i)
+    keyframes[i] = at(i);
+  keyframes_.swap(keyframes);
+  head_ = 0;
+}
+
+bool CompiledTrajectory::sample(double time, size_t& movement, double& relative_progress_in_time)
+{
+  const size_t last = size_ - 1;
+
+  if(time >= at(last).end_time)
+  {
+    // every keyframe is reached, the movement appended next is searched for again
+    cursor_ = size_;
+    movement = last;
+    relative_progress_in_time = 1.0;
+    return false;
+  }
+
+  // try the movement played last and the one after it before searching
+  if(cursor_ > last || time < at(cursor_ - 1).end_time)
+  {
+    cursor_ = 0;
+  }
+  else if(time >= at(cursor_).end_time)
+  {
+    cursor_++;
+    if(time >= at(cursor_).end_time)
+      cursor_ = 0;
+  }
+
+  if(cursor_ == 0)
+  {
+    // upper bound over the ring: the first goal keyframe reached after time, the last one is known to be
+    size_t low = 1, high = last;
+    while(low < high)
+    {
+      const size_t middle = low + (high - low) / 2;
+      if(time < at(middle).end_time)
+        high = middle;
+      else
+        low = middle + 1;
+    }
+    cursor_ = low;
+  }
+
+  movement = cursor_;
+  const double start_time = at(cursor_ - 1).end_time;
+  const double duration = at(cursor_).end_time - start_time;
+  relative_progress_in_time = duration > 0.0 ? std::max(0.0, (time - start_time) / duration) : 1.0;
+  return true;
+}
+
+void CompiledTrajectory::interpolateLinear(size_t movement, float relative_progress_in_space,
+                                           Ogre::Vector3& eye, Ogre::Vector3& focus, Ogre::Vector3& up) const
+{
+  const Keyframe& start = at(movement - 1);
+  const Keyframe& goal = at(movement);
+
+  eye = start.eye + relative_progress_in_space * (goal.eye - start.eye);
+  focus = start.focus + relative_progress_in_space * (goal.focus - start.focus);
+  up = start.up + relative_progress_in_space * (goal.up - start.up);
+}
+
+void CompiledTrajectory::interpolateSpherical(size_t movement, float relative_progress_in_space,
+                                              Ogre::Vector3& eye, Ogre::Vector3& focus, Ogre::Vector3& up) const
+{
+  const Keyframe& start = at(movement - 1);
+  const Keyframe& goal = at(movement);
+
+  focus = start.focus + relative_progress_in_space * (goal.focus - start.focus);
+  eye = focus + slerpVector(start.eye - start.focus, goal.eye - goal.focus, relative_progress_in_space);
+  up = slerpVector(start.up, goal.up, relative_progress_in_space);
+}
+
+void CompiledTrajectory::interpolateSpline(size_t movement, float relative_progress_in_space,
+                                           Ogre::Vector3& eye, Ogre::Vector3& focus, Ogre::Vector3& up) const
+{
+  const Keyframe& start = at(movement - 1);
+  const Keyframe& goal = at(movement);
+
+  // the first and the last keyframe use one sided differences
+  const Keyframe& before = at(movement > 1 ? movement - 2 : movement - 1);
+  const Keyframe& after = at(std::min(movement + 1, size_ - 1));
+
+  const double duration = goal.end_time - start.end_time;
+  // tangents in units per second, scaled to the duration of this movement
+  const double start_scale = duration / std::max(MIN_TIME_SPAN, goal.end_time - before.end_time);
+  const double goal_scale = duration / std::max(MIN_TIME_SPAN, after.end_time - start.end_time);
+
+  const float t = relative_progress_in_space;
+  const float t2 = t * t;
+  const float t3 = t2 * t;
+  const float h00 = 2.f * t3 - 3.f * t2 + 1.f;
+  const float h10 = t3 - 2.f * t2 + t;
+  const float h01 = -2.f * t3 + 3.f * t2;
+  const float h11 = t3 - t2;
+
+  eye = h00 * start.eye + h01 * goal.eye
+        + (h10 * static_cast<float>(start_scale)) * (goal.eye - before.eye)
+        + (h11 * static_cast<float>(goal_scale)) * (after.eye - start.eye);
+  focus = h00 * start.focus + h01 * goal.focus
+          + (h10 * static_cast<float>(start_scale)) * (goal.focus - before.focus)
+          + (h11 * static_cast<float>(goal_scale)) * (after.focus - start.focus);
+  up = slerpVector(start.up, goal.up, t);
+}
+
+Ogre::Vector3 CompiledTrajectory::slerpVector(const Ogre::Vector3& from, const Ogre::Vector3& to, float t)
+{
+  const float from_length = from.length();
+  const float to_length = to.length();
+  if(from_length < 1e-6f || to_length < 1e-6f)
+    return from + t * (to - from);
+
+  const Ogre::Vector3 from_direction = from / from_length;
+  const Ogre::Quaternion rotation = from_direction.getRotationTo(to / to_length);
+  const Ogre::Quaternion partial_rotation = Ogre::Quaternion::Slerp(t, Ogre::Quaternion::IDENTITY, rotation, true);
+
+  return (partial_rotation * from_direction) * (from_length + t * (to_length - from_length));
+}
+
+void CompiledTrajectory::discardPlayedMovements()
+{
+  // keep the start keyframe of the current movement and the one before, which the spline tangent depends on
+  const size_t played = cursor_ >= 2 ? std::min(cursor_ - 2, size_) : 0;
+  if(played == 0 || (max_size_ == 0 && (played < DISCARD_THRESHOLD || played < size_ / 2)))
+    return;
+
+  head_ = (head_ + played) % keyframes_.size();
+  size_ -= played;
+  cursor_ -= played;
+}
+
+}  // namespace rviz_animated_view_controller
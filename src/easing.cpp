@@ -0,0 +1,162 @@
+/*
+ * Copyright (c) 2012, Willow Garage, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Willow Garage, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "rviz_animated_view_controller/easing.h"
+
+#include <algorithm>
+#include <sstream>
+
+namespace rviz_animated_view_controller
+{
+
+CubicBezierEasing::CubicBezierEasing(double x1, double y1, double x2, double y2)
+{
+  x1 = std::min(std::max(0.0, x1), 1.0);
+  x2 = std::min(std::max(0.0, x2), 1.0);
+
+  cx_ = 3.0 * x1;
+  bx_ = 3.0 * (x2 - x1) - cx_;
+  ax_ = 1.0 - cx_ - bx_;
+  cy_ = 3.0 * y1;
+  by_ = 3.0 * (y2 - y1) - cy_;
+  ay_ = 1.0 - cy_ - by_;
+}
+
+bool CubicBezierEasing::parse(const std::string& text)
+{
+  std::string numbers = text;
+  std::replace(numbers.begin(), numbers.end(), ',', ' ');
+  std::istringstream ss(numbers);
+  double x1, y1, x2, y2;
+  if(!(ss >> x1 >> y1 >> x2 >> y2))
+    return false;
+
+  *this = CubicBezierEasing(x1, y1, x2, y2);
+  return true;
+}
+
+double CubicBezierEasing::solveCurveParameter(double t) const
+{
+  // Newton's method converges in a few steps on all but the flattest curves
+  double s = t;
+  for(int i = 0; i < 8; ++i)
+  {
+    const double error = ((ax_ * s + bx_) * s + cx_) * s - t;
+    if(std::abs(error) < 1e-7)
+      return s;
+    const double derivative = (3.0 * ax_ * s + 2.0 * bx_) * s + cx_;
+    if(std::abs(derivative) < 1e-6)
+      break;
+    s -= error / derivative;
+  }
+
+  // x(s) is monotonic in [0, 1], bisection always converges
+  double low = 0.0, high = 1.0;
+  s = t;
+  for(int i = 0; i < 32; ++i)
+  {
+    const double x = ((ax_ * s + bx_) * s + cx_) * s;
+    if(std::abs(x - t) < 1e-7)
+      break;
+    if(x < t)
+      low = s;
+    else
+      high = s;
+    s = 0.5 * (low + high);
+  }
+  return s;
+}
+
+float CubicBezierEasing::evaluate(double t) const
+{
+  t = std::min(std::max(0.0, t), 1.0);
+  const double s = solveCurveParameter(t);
+  return static_cast<float>(((ay_ * s + by_) * s + cy_) * s);
+}
+
+void CubicBezierEasing::evaluate(const double* times, float* progress, size_t count) const
+{
+  for(size_t i = 0; i < count; ++i)
+    progress[i] = evaluate(times[i]);
+}
+
+float evaluateEasing(uint8_t profile, double t, const CubicBezierEasing& bezier)
+{
+  switch(profile)
+  {
+    case EASING_RISING:
+      return Easing<EASING_RISING>::evaluate(t);
+    case EASING_DECLINING:
+      return Easing<EASING_DECLINING>::evaluate(t);
+    case EASING_FULL:
+      return Easing<EASING_FULL>::evaluate(t);
+    case EASING_CUBIC:
+      return Easing<EASING_CUBIC>::evaluate(t);
+    case EASING_QUINTIC:
+      return Easing<EASING_QUINTIC>::evaluate(t);
+    case EASING_BEZIER:
+      return bezier.evaluate(t);
+    case EASING_WAVE:
+    default:
+      return Easing<EASING_WAVE>::evaluate(t);
+  }
+}
+
+void evaluateEasing(uint8_t profile, const double* times, float* progress, size_t count,
+                    const CubicBezierEasing& bezier)
+{
+  switch(profile)
+  {
+    case EASING_RISING:
+      evaluateEasing<EASING_RISING>(times, progress, count);
+      break;
+    case EASING_DECLINING:
+      evaluateEasing<EASING_DECLINING>(times, progress, count);
+      break;
+    case EASING_FULL:
+      evaluateEasing<EASING_FULL>(times, progress, count);
+      break;
+    case EASING_CUBIC:
+      evaluateEasing<EASING_CUBIC>(times, progress, count);
+      break;
+    case EASING_QUINTIC:
+      evaluateEasing<EASING_QUINTIC>(times, progress, count);
+      break;
+    case EASING_BEZIER:
+      bezier.evaluate(times, progress, count);
+      break;
+    case EASING_WAVE:
+    default:
+      evaluateEasing<EASING_WAVE>(times, progress, count);
+      break;
+  }
+}
+
+}  // namespace rviz_animated_view_controller
@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) 2012, Willow Garage, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Willow Garage, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "rviz_animated_view_controller/image_buffer_pool.h"
+
+#include <algorithm>
+
+namespace rviz_animated_view_controller
+{
+
+void ImageBufferPool::Recycler::operator()(sensor_msgs::Image* image) const
+{
+  std::lock_guard<std::mutex> lock(storage->mutex);
+  storage->free_images.emplace_back(image);
+  storage->lent_images--;
+}
+
+ImageBufferPool::ImageBufferPool(size_t pool_size)
+  : storage_(std::make_shared<Storage>())
+    , width_(0)
+    , height_(0)
+    , bytes_per_pixel_(0)
+    , data_rows_(0)
+    , allocations_(0)
+{
+  for(size_t i = 0; i < pool_size; ++i)
+    storage_->free_images.emplace_back(new sensor_msgs::Image());
+}
+
+bool ImageBufferPool::configure(unsigned int width, unsigned int height,
+                                const std::string& encoding, unsigned int bytes_per_pixel, unsigned int data_rows)
+{
+  std::lock_guard<std::mutex> lock(storage_->mutex);
+
+  if(data_rows == 0)
+    data_rows = height;
+
+  if(width == width_ && height == height_ && encoding == encoding_ && bytes_per_pixel == bytes_per_pixel_
+     && data_rows == data_rows_)
+    return false;
+
+  width_ = width;
+  height_ = height;
+  encoding_ = encoding;
+  bytes_per_pixel_ = bytes_per_pixel;
+  data_rows_ = data_rows;
+
+  for(auto& image : storage_->free_images)
+    allocate(*image);
+
+  return true;
+}
+
+sensor_msgs::ImagePtr ImageBufferPool::acquire()
+{
+  std::lock_guard<std::mutex> lock(storage_->mutex);
+
+  std::unique_ptr<sensor_msgs::Image> image;
+  if(storage_->free_images.empty())
+  {
+    image.reset(new sensor_msgs::Image());
+  }
+  else
+  {
+    image = std::move(storage_->free_images.back());
+    storage_->free_images.pop_back();
+  }
+
+  // no-op unless the geometry changed while the image was lent out, or a consumer resized it
+  allocate(*image);
+  storage_->lent_images++;
+
+  // the recycler holds on to the storage, which lets images outlive the pool
+  return sensor_msgs::ImagePtr(image.release(), Recycler{storage_});
+}
+
+size_t ImageBufferPool::getLentImages() const
+{
+  std::lock_guard<std::mutex> lock(storage_->mutex);
+  return storage_->lent_images;
+}
+
+void ImageBufferPool::allocate(sensor_msgs::Image& image)
+{
+  image.width = width_;
+  image.height = height_;
+  image.encoding = encoding_;
+  image.is_bigendian = false;
+  image.step = width_ * bytes_per_pixel_;
+
+  const size_t size = static_cast<size_t>(image.step) * data_rows_;
+  if(image.data.size() != size)
+  {
+    // swap with a fresh vector so shrinking actually gives the memory back
+    std::vector<uint8_t>(size).swap(image.data);
+    if(size > 0)
+      allocations_++;
+  }
+}
+
+}  // namespace rviz_animated_view_controller
@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) 2012, Willow Garage, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Willow Garage, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "rviz_animated_view_controller/image_publish_worker.h"
+
+#include <algorithm>
+
+namespace rviz_animated_view_controller
+{
+
+ImagePublishWorker::ImagePublishWorker(const ImageFunction& publish)
+  : publish_(publish)
+    , queued_images_(0)
+    , queue_depth_(2)
+    , policy_(DROP_OLDEST)
+    , dropped_images_(0)
+    , stop_(false)
+{
+  thread_ = std::thread(&ImagePublishWorker::run, this);
+}
+
+ImagePublishWorker::~ImagePublishWorker()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  job_queued_.notify_all();
+  job_done_.notify_all();
+  thread_.join();
+}
+
+void ImagePublishWorker::setQueueDepth(size_t queue_depth)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  queue_depth_ = std::max<size_t>(1, queue_depth);
+}
+
+void ImagePublishWorker::setOverflowPolicy(OverflowPolicy policy)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  policy_ = policy;
+}
+
+void ImagePublishWorker::push(const sensor_msgs::ImagePtr& image, const ros::Time& stamp, const std::string& frame_id,
+                              unsigned int stream, uint32_t seq)
+{
+  sensor_msgs::ImagePtr dropped_image;
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    if(policy_ == BLOCK)
+    {
+      job_done_.wait(lock, [this]{ return queued_images_ < queue_depth_ || stop_; });
+    }
+    else if(queued_images_ >= queue_depth_)
+    {
+      // drop the oldest image, tasks have to be kept in order
+      auto oldest = std::find_if(jobs_.begin(), jobs_.end(), [](const Job& job){ return job.image != nullptr; });
+      dropped_image = oldest->image;
+      jobs_.erase(oldest);
+      queued_images_--;
+      dropped_images_++;
+    }
+
+    Job job;
+    job.image = image;
+    job.stamp = stamp;
+    job.frame_id = frame_id;
+    job.stream = stream;
+    job.seq = seq;
+    jobs_.push_back(job);
+    queued_images_++;
+  }
+  job_queued_.notify_one();
+
+  // a dropped image returns to its pool outside of the lock
+  dropped_image.reset();
+}
+
+void ImagePublishWorker::post(const std::function<void()>& task)
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Job job;
+    job.stream = 0;
+    job.seq = 0;
+    job.task = task;
+    jobs_.push_back(job);
+  }
+  job_queued_.notify_one();
+}
+
+void ImagePublishWorker::run()
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+  while(true)
+  {
+    job_queued_.wait(lock, [this]{ return !jobs_.empty() || stop_; });
+    if(jobs_.empty())
+      break;  // stop requested and everything was published
+
+    Job job = jobs_.front();
+    jobs_.pop_front();
+    if(job.image)
+      queued_images_--;
+    lock.unlock();
+    job_done_.notify_all();
+
+    if(job.image)
+    {
+      job.image->header.seq = job.seq;
+      job.image->header.stamp = job.stamp;
+      job.image->header.frame_id = job.frame_id;
+      publish_(job.image, job.stream);
+      job.image.reset();
+    }
+    else if(job.task)
+    {
+      job.task();
+    }
+
+    lock.lock();
+  }
+}
+
+}  // namespace rviz_animated_view_controller
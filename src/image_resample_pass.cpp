@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2012, Willow Garage, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Willow Garage, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "rviz_animated_view_controller/image_resample_pass.h"
+
+#define GL_GLEXT_PROTOTYPES
+#include <GL/gl.h>
+#include <GL/glext.h>
+
+namespace rviz_animated_view_controller
+{
+
+static const char* const FRAGMENT_SHADER =
+  "#version 120\n"
+  "uniform sampler2D source;\n"
+  "uniform vec4 region;\n"  // offset and size of the region in texture coordinates
+  "uniform vec2 size;\n"    // size of the result in pixels
+  "void main()\n"
+  "{\n"
+  "  gl_FragColor = vec4(texture2D(source, region.xy + gl_FragCoord.xy / size * region.zw).rgb, 1.0);\n"
+  "}\n";
+
+ImageResamplePass::ImageResamplePass()
+  : pass_("image resampling", FRAGMENT_SHADER, ShaderPass::RGB8)
+{
+}
+
+bool ImageResamplePass::resample(unsigned int source_texture_id, unsigned int source_width,
+                                 unsigned int source_height, unsigned int region_x, unsigned int region_y,
+                                 unsigned int region_width, unsigned int region_height,
+                                 unsigned int width, unsigned int height)
+{
+  if(source_width == 0 || source_height == 0)
+    return false;
+
+  const float texture_width = static_cast<float>(source_width);
+  const float texture_height = static_cast<float>(source_height);
+  const float region[4] = {region_x / texture_width, region_y / texture_height,
+                           region_width / texture_width, region_height / texture_height};
+  const float size[2] = {static_cast<float>(width), static_cast<float>(height)};
+
+  return pass_.run(source_texture_id, width, height, [&region, &size](unsigned int program)
+  {
+    glUniform4fv(glGetUniformLocation(program, "region"), 1, region);
+    glUniform2fv(glGetUniformLocation(program, "size"), 1, size);
+  });
+}
+
+void ImageResamplePass::copyContentsToMemory(sensor_msgs::Image& image)
+{
+  if(image.data.size() < static_cast<size_t>(getWidth()) * getHeight() * 3)
+    return;
+
+  pass_.copyContentsToMemory(image.data.data());
+}
+
+}  // namespace rviz_animated_view_controller
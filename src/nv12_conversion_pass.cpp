@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2012, Willow Garage, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Willow Garage, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "rviz_animated_view_controller/nv12_conversion_pass.h"
+
+#define GL_GLEXT_PROTOTYPES
+#include <GL/gl.h>
+#include <GL/glext.h>
+
+#include <algorithm>
+
+namespace rviz_animated_view_controller
+{
+
+const std::string Nv12ConversionPass::ENCODING = "nv12";
+
+// rows [0, height) of the target receive the luma plane, rows [height, 3/2 height) the interleaved chroma plane
+static const char* const FRAGMENT_SHADER =
+  "#version 120\n"
+  "uniform sampler2D source;\n"
+  "uniform vec2 size;\n"
+  "const vec3 Y_COEFFICIENTS = vec3(0.257, 0.504, 0.098);\n"
+  "const vec3 U_COEFFICIENTS = vec3(-0.148, -0.291, 0.439);\n"
+  "const vec3 V_COEFFICIENTS = vec3(0.439, -0.368, -0.071);\n"
+  "void main()\n"
+  "{\n"
+  "  vec2 pixel = floor(gl_FragCoord.xy);\n"
+  "  if(pixel.y < size.y)\n"
+  "  {\n"
+  "    vec3 rgb = texture2D(source, (pixel + 0.5) / size).rgb;\n"
+  "    gl_FragColor = vec4(dot(rgb, Y_COEFFICIENTS) + 16.0 / 255.0);\n"
+  "  }\n"
+  "  else\n"
+  "  {\n"
+  "    // sampling the corner shared by a 2x2 block with bilinear filtering averages the block\n"
+  "    vec2 block = vec2(floor(pixel.x / 2.0), pixel.y - size.y);\n"
+  "    vec3 rgb = texture2D(source, (2.0 * block + 1.0) / size).rgb;\n"
+  "    float chroma = mod(pixel.x, 2.0) < 0.5 ? dot(rgb, U_COEFFICIENTS) : dot(rgb, V_COEFFICIENTS);\n"
+  "    gl_FragColor = vec4(chroma + 128.0 / 255.0);\n"
+  "  }\n"
+  "}\n";
+
+Nv12ConversionPass::Nv12ConversionPass()
+  : pass_("NV12 conversion", FRAGMENT_SHADER, ShaderPass::R8)
+    , width_(0)
+    , height_(0)
+{
+}
+
+void Nv12ConversionPass::release()
+{
+  pass_.release();
+  width_ = 0;
+  height_ = 0;
+}
+
+bool Nv12ConversionPass::convert(unsigned int source_texture_id, unsigned int width, unsigned int height)
+{
+  width_ = std::max(2u, width & ~1u);
+  height_ = std::max(2u, height & ~1u);
+
+  const float image_width = static_cast<float>(width_);
+  const float image_height = static_cast<float>(height_);
+  return pass_.run(source_texture_id, width_, height_ * 3 / 2, [image_width, image_height](unsigned int program)
+  {
+    glUniform2f(glGetUniformLocation(program, "size"), image_width, image_height);
+  });
+}
+
+void Nv12ConversionPass::copyContentsToMemory(sensor_msgs::Image& image)
+{
+  if(image.data.size() < static_cast<size_t>(width_) * height_ * 3 / 2)
+    return;
+
+  pass_.copyContentsToMemory(image.data.data());
+}
+
+}  // namespace rviz_animated_view_controller
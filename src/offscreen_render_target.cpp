@@ -0,0 +1,278 @@
+/*
+ * Copyright (c) 2012, Willow Garage, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Willow Garage, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "rviz_animated_view_controller/offscreen_render_target.h"
+
+#define GL_GLEXT_PROTOTYPES
+#include <GL/gl.h>
+#include <GL/glext.h>
+
+#include <OGRE/OgreCamera.h>
+#include <OGRE/OgreHardwarePixelBuffer.h>
+#include <OGRE/OgreRenderTexture.h>
+#include <OGRE/OgreTextureManager.h>
+#include <OGRE/OgreViewport.h>
+
+#include <algorithm>
+#include <sstream>
+
+namespace rviz_animated_view_controller
+{
+
+// largest supersampling factor, the loops of the downsampling shader run up to it
+static const unsigned int MAX_SUPERSAMPLING = 4;
+
+static const char* const DOWNSAMPLING_SHADER =
+  "#version 120\n"
+  "uniform sampler2D source;\n"
+  "uniform vec2 size;\n"     // size of the target in pixels
+  "uniform int factor;\n"    // supersampling factor, the source is factor times larger
+  "void main()\n"
+  "{\n"
+  // box filter over the factor x factor source texels of this pixel, sampled at their centres so the bilinear
+  // filter of the source does not blend neighbours in
+  "  vec2 texel = 1.0 / (size * float(factor));\n"
+  "  vec2 origin = (floor(gl_FragCoord.xy) * float(factor) + 0.5) * texel;\n"
+  "  vec3 sum = vec3(0.0);\n"
+  "  for(int y = 0; y < 4; ++y)\n"
+  "    for(int x = 0; x < 4; ++x)\n"
+  "      if(x < factor && y < factor)\n"
+  "        sum += texture2D(source, origin + vec2(x, y) * texel).rgb;\n"
+  "  gl_FragColor = vec4(sum / float(factor * factor), 1.0);\n"
+  "}\n";
+
+static const char* const ACCUMULATION_SHADER =
+  "#version 120\n"
+  "uniform sampler2D source;\n"
+  "uniform vec2 size;\n"   // size of source and target in pixels
+  "void main()\n"
+  "{\n"
+  "  gl_FragColor = vec4(texture2D(source, gl_FragCoord.xy / size).rgb, 1.0);\n"
+  "}\n";
+
+OffscreenRenderTarget::OffscreenRenderTarget()
+  : camera_(nullptr)
+    , width_(0)
+    , height_(0)
+    , supersampling_(1)
+    , multisampling_(0)
+    , background_colour_(Ogre::ColourValue::Black)
+    , downsampling_pass_("supersampling", DOWNSAMPLING_SHADER, ShaderPass::RGB8)
+    , downsampled_(false)
+    , accumulation_pass_("sub-frame accumulation", ACCUMULATION_SHADER, ShaderPass::RGB16F)
+    , accumulated_(false)
+{
+  static unsigned int count = 0;
+  std::stringstream ss;
+  ss << "AnimatedViewControllerOffscreen" << count++;
+  name_ = ss.str();
+}
+
+OffscreenRenderTarget::~OffscreenRenderTarget()
+{
+  destroy();
+}
+
+void OffscreenRenderTarget::configure(Ogre::Camera* camera, unsigned int width, unsigned int height,
+                                      unsigned int supersampling, unsigned int multisampling)
+{
+  width = std::max(1u, width);
+  height = std::max(1u, height);
+  supersampling = std::min(std::max(1u, supersampling), MAX_SUPERSAMPLING);
+
+  if(isValid() && camera == camera_ && width == width_ && height == height_ && supersampling == supersampling_
+     && multisampling == multisampling_)
+    return;
+
+  destroy();
+
+  camera_ = camera;
+  width_ = width;
+  height_ = height;
+  supersampling_ = supersampling;
+  multisampling_ = multisampling;
+
+  // only the texture the scene is rendered into is multisampled, a blit from it reads the resolved image
+  output_texture_ = createTexture(name_ + "Output", width_, height_, supersampling_ > 1 ? 0 : multisampling_);
+  if(supersampling_ > 1)
+    supersampled_texture_ = createTexture(name_ + "Supersampled", width_ * supersampling_, height_ * supersampling_,
+                                          multisampling_);
+
+  // the scene is only rendered into the largest texture, the output is filled by downsampling on the GPU
+  Ogre::TexturePtr& scene_texture = supersampling_ > 1 ? supersampled_texture_ : output_texture_;
+  Ogre::Viewport* viewport = scene_texture->getBuffer()->getRenderTarget()->addViewport(camera_);
+  viewport->setClearEveryFrame(true);
+  viewport->setBackgroundColour(background_colour_);
+  viewport->setOverlaysEnabled(false);
+}
+
+void OffscreenRenderTarget::setBackgroundColour(const Ogre::ColourValue& colour)
+{
+  background_colour_ = colour;
+
+  Ogre::TexturePtr& scene_texture = supersampling_ > 1 ? supersampled_texture_ : output_texture_;
+  if(!scene_texture.isNull())
+    scene_texture->getBuffer()->getRenderTarget()->getViewport(0)->setBackgroundColour(colour);
+}
+
+void OffscreenRenderTarget::render()
+{
+  accumulated_ = false;
+  renderScene();
+}
+
+bool OffscreenRenderTarget::accumulate(unsigned int sample)
+{
+  if(!isValid())
+    return false;
+
+  renderScene();
+
+  const unsigned int texture_id = getSceneResultTextureId();
+  const float size[2] = {static_cast<float>(width_), static_cast<float>(height_)};
+  // blending sub-frame k with 1 / (k + 1) keeps the target the mean of all sub-frames so far
+  accumulated_ = accumulation_pass_.run(texture_id, width_, height_, [&size](unsigned int program)
+  {
+    glUniform2fv(glGetUniformLocation(program, "size"), 1, size);
+  }, 1.0f / static_cast<float>(sample + 1));
+  return accumulated_;
+}
+
+void OffscreenRenderTarget::renderScene()
+{
+  if(!isValid())
+    return;
+
+  Ogre::RenderTexture* scene_target = (supersampling_ > 1 ? supersampled_texture_ : output_texture_)
+                                      ->getBuffer()->getRenderTarget();
+
+  // the camera is shared with the render panel, which has its own aspect ratio
+  const Ogre::Real panel_aspect_ratio = camera_->getAspectRatio();
+  camera_->setAspectRatio(static_cast<Ogre::Real>(width_) / static_cast<Ogre::Real>(height_));
+  scene_target->update();
+  camera_->setAspectRatio(panel_aspect_ratio);
+
+  downsampled_ = false;
+  if(supersampling_ == 1)
+    return;
+
+  unsigned int texture_id = 0;
+  supersampled_texture_->getCustomAttribute("GLID", &texture_id);
+  const float size[2] = {static_cast<float>(width_), static_cast<float>(height_)};
+  const int factor = static_cast<int>(supersampling_);
+  downsampled_ = downsampling_pass_.run(texture_id, width_, height_, [&size, factor](unsigned int program)
+  {
+    glUniform2fv(glGetUniformLocation(program, "size"), 1, size);
+    glUniform1i(glGetUniformLocation(program, "factor"), factor);
+  });
+
+  // without shaders, Ogre's blit filters bilinearly and only reads 2 x 2 of the samples of every pixel
+  if(!downsampled_)
+    output_texture_->getBuffer()->blit(supersampled_texture_->getBuffer());
+}
+
+unsigned int OffscreenRenderTarget::getSceneResultTextureId() const
+{
+  unsigned int texture_id = 0;
+  if(downsampled_)
+    texture_id = downsampling_pass_.getTextureId();
+  else
+    output_texture_->getCustomAttribute("GLID", &texture_id);
+  return texture_id;
+}
+
+void OffscreenRenderTarget::copyContentsToMemory(sensor_msgs::Image& image)
+{
+  if(!isValid())
+    return;
+
+  if(accumulated_)
+  {
+    if(image.data.size() >= static_cast<size_t>(width_) * height_ * 3)
+      accumulation_pass_.copyContentsToMemory(image.data.data());
+    return;
+  }
+
+  if(downsampled_)
+  {
+    if(image.data.size() >= static_cast<size_t>(width_) * height_ * 3)
+      downsampling_pass_.copyContentsToMemory(image.data.data());
+    return;
+  }
+
+  Ogre::Box image_extents(0, 0, image.width, image.height);
+  Ogre::PixelBox pixel_box(image_extents, Ogre::PF_BYTE_BGR, image.data.data());
+  output_texture_->getBuffer()->blitToMemory(pixel_box);
+}
+
+unsigned int OffscreenRenderTarget::getTextureId() const
+{
+  unsigned int texture_id = 0;
+  if(accumulated_)
+    texture_id = accumulation_pass_.getTextureId();
+  else if(isValid())
+    texture_id = getSceneResultTextureId();
+  return texture_id;
+}
+
+void OffscreenRenderTarget::destroy()
+{
+  destroyTexture(supersampled_texture_);
+  destroyTexture(output_texture_);
+  downsampling_pass_.release();
+  downsampled_ = false;
+  accumulation_pass_.release();
+  accumulated_ = false;
+}
+
+Ogre::TexturePtr OffscreenRenderTarget::createTexture(const std::string& name, unsigned int width, unsigned int height,
+                                                      unsigned int multisampling)
+{
+  Ogre::TexturePtr texture = Ogre::TextureManager::getSingleton().createManual(
+                               name, Ogre::ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME, Ogre::TEX_TYPE_2D,
+                               width, height, 0, Ogre::PF_R8G8B8, Ogre::TU_RENDERTARGET, nullptr, false,
+                               multisampling);
+
+  // rendered on demand only, not by Ogre::Root::renderOneFrame()
+  texture->getBuffer()->getRenderTarget()->setAutoUpdated(false);
+  return texture;
+}
+
+void OffscreenRenderTarget::destroyTexture(Ogre::TexturePtr& texture)
+{
+  if(texture.isNull())
+    return;
+
+  texture->getBuffer()->getRenderTarget()->removeAllViewports();
+  Ogre::TextureManager::getSingleton().remove(texture->getName());
+  texture.setNull();
+}
+
+}  // namespace rviz_animated_view_controller
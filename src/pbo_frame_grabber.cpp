@@ -0,0 +1,251 @@
+/*
+ * Copyright (c) 2012, Willow Garage, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Willow Garage, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "rviz_animated_view_controller/pbo_frame_grabber.h"
+#include "rviz_animated_view_controller/nv12_conversion_pass.h"
+
+#include <sensor_msgs/image_encodings.h>
+
+#define GL_GLEXT_PROTOTYPES
+#include <GL/gl.h>
+#include <GL/glext.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace rviz_animated_view_controller
+{
+
+static unsigned int bytesPerPixel(PboFrameGrabber::Format format)
+{
+  return format == PboFrameGrabber::NV12 ? 1 : 3;  // GL_RED or GL_BGR, GL_UNSIGNED_BYTE
+}
+
+static unsigned int dataRows(PboFrameGrabber::Format format, unsigned int height)
+{
+  return format == PboFrameGrabber::NV12 ? height * 3 / 2 : height;
+}
+
+PboFrameGrabber::PboFrameGrabber(unsigned int ring_size)
+  : write_index_(0)
+    , read_index_(0)
+    , pending_frames_(0)
+    , dropped_frames_(0)
+    , previous_pack_alignment_(4)
+{
+  slots_.resize(std::max(2u, ring_size));
+}
+
+PboFrameGrabber::~PboFrameGrabber()
+{
+  release();
+}
+
+void PboFrameGrabber::setRingSize(unsigned int ring_size)
+{
+  ring_size = std::max(2u, ring_size);
+  if(ring_size == slots_.size())
+    return;
+
+  release();
+  slots_.resize(ring_size);
+}
+
+void PboFrameGrabber::release()
+{
+  for(auto& slot : slots_)
+  {
+    if(slot.buffer != 0)
+      glDeleteBuffers(1, &slot.buffer);
+    slot = Slot();
+  }
+  write_index_ = 0;
+  read_index_ = 0;
+  pending_frames_ = 0;
+}
+
+void PboFrameGrabber::grab(unsigned int x, unsigned int y, unsigned int width, unsigned int height,
+                           const ros::Time& stamp)
+{
+  GLint previous_read_framebuffer = 0, previous_read_buffer = 0;
+  glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &previous_read_framebuffer);
+  glGetIntegerv(GL_READ_BUFFER, &previous_read_buffer);
+
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+  glReadBuffer(GL_BACK);
+
+  Slot& slot = beginTransfer(width, height, BGR8);
+  // with a pack buffer bound, glReadPixels only queues the transfer and the last parameter is an offset
+  glReadPixels(x, y, width, height, GL_BGR, GL_UNSIGNED_BYTE, nullptr);
+  endTransfer(slot, width, height, BGR8, stamp, true);
+
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, previous_read_framebuffer);
+  glReadBuffer(previous_read_buffer);
+}
+
+void PboFrameGrabber::readWindow(unsigned int x, unsigned int y, unsigned int width, unsigned int height,
+                                 sensor_msgs::Image& image)
+{
+  const size_t step = static_cast<size_t>(width) * bytesPerPixel(BGR8);
+  if(height == 0 || image.data.size() < step * height)
+    return;
+
+  GLint previous_read_framebuffer = 0, previous_read_buffer = 0, previous_pack_alignment = 0;
+  glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &previous_read_framebuffer);
+  glGetIntegerv(GL_READ_BUFFER, &previous_read_buffer);
+  glGetIntegerv(GL_PACK_ALIGNMENT, &previous_pack_alignment);
+
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+  glReadBuffer(GL_BACK);
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+
+  glReadPixels(x, y, width, height, GL_BGR, GL_UNSIGNED_BYTE, image.data.data());
+
+  glPixelStorei(GL_PACK_ALIGNMENT, previous_pack_alignment);
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, previous_read_framebuffer);
+  glReadBuffer(previous_read_buffer);
+
+  // GL returns the bottom row first
+  std::vector<unsigned char> row(step);
+  for(unsigned int top = 0, bottom = height - 1; top < bottom; ++top, --bottom)
+  {
+    memcpy(row.data(), &image.data[top * step], step);
+    memcpy(&image.data[top * step], &image.data[bottom * step], step);
+    memcpy(&image.data[bottom * step], row.data(), step);
+  }
+}
+
+void PboFrameGrabber::grabTexture(unsigned int texture_id, unsigned int width, unsigned int height,
+                                  const ros::Time& stamp, Format format)
+{
+  GLint previous_texture = 0;
+  glGetIntegerv(GL_TEXTURE_BINDING_2D, &previous_texture);
+  glBindTexture(GL_TEXTURE_2D, texture_id);
+
+  Slot& slot = beginTransfer(width, height, format);
+  // Ogre renders into textures upside down, so the texture memory already starts with the top row
+  glGetTexImage(GL_TEXTURE_2D, 0, format == NV12 ? GL_RED : GL_BGR, GL_UNSIGNED_BYTE, nullptr);
+  endTransfer(slot, width, height, format, stamp, false);
+
+  glBindTexture(GL_TEXTURE_2D, previous_texture);
+}
+
+PboFrameGrabber::Slot& PboFrameGrabber::beginTransfer(unsigned int width, unsigned int height, Format format)
+{
+  Slot& slot = slots_[write_index_];
+
+  if(slot.pending)
+  {
+    // the consumer did not keep up, drop the oldest frame to make room
+    dropped_frames_++;
+    pending_frames_--;
+    read_index_ = (read_index_ + 1) % slots_.size();
+  }
+
+  if(slot.buffer == 0)
+    glGenBuffers(1, &slot.buffer);
+
+  const size_t size = static_cast<size_t>(width) * dataRows(format, height) * bytesPerPixel(format);
+
+  glGetIntegerv(GL_PACK_ALIGNMENT, &previous_pack_alignment_);
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+  if(slot.capacity != size)
+  {
+    glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ);
+    slot.capacity = size;
+  }
+  return slot;
+}
+
+void PboFrameGrabber::endTransfer(Slot& slot, unsigned int width, unsigned int height, Format format,
+                                  const ros::Time& stamp, bool bottom_up)
+{
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  glPixelStorei(GL_PACK_ALIGNMENT, previous_pack_alignment_);
+
+  slot.width = width;
+  slot.height = height;
+  slot.format = format;
+  slot.stamp = stamp;
+  slot.bottom_up = bottom_up;
+  slot.pending = true;
+  pending_frames_++;
+
+  write_index_ = (write_index_ + 1) % slots_.size();
+}
+
+bool PboFrameGrabber::retrieve(sensor_msgs::Image& image, ros::Time& stamp, bool flush)
+{
+  if(pending_frames_ == 0 || (!flush && pending_frames_ < slots_.size()))
+    return false;
+
+  Slot& slot = slots_[read_index_];
+
+  const size_t step = static_cast<size_t>(slot.width) * bytesPerPixel(slot.format);
+  const unsigned int rows = dataRows(slot.format, slot.height);
+
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+  const unsigned char* mapped = static_cast<const unsigned char*>(glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY));
+
+  bool success = mapped != nullptr;
+  if(success)
+  {
+    image.height = slot.height;
+    image.width = slot.width;
+    image.encoding = slot.format == NV12 ? Nv12ConversionPass::ENCODING : sensor_msgs::image_encodings::BGR8;
+    image.is_bigendian = false;
+    image.step = static_cast<unsigned int>(step);
+    image.data.resize(step * rows);
+
+    if(slot.bottom_up)
+    {
+      for(unsigned int row = 0; row < rows; ++row)
+        memcpy(&image.data[row * step], mapped + (rows - 1 - row) * step, step);
+    }
+    else
+    {
+      memcpy(image.data.data(), mapped, step * rows);
+    }
+
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    stamp = slot.stamp;
+  }
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+  slot.pending = false;
+  pending_frames_--;
+  read_index_ = (read_index_ + 1) % slots_.size();
+
+  return success;
+}
+
+}  // namespace rviz_animated_view_controller
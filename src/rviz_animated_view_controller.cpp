@@ -42,9 +42,12 @@
 #include "rviz/properties/float_property.h"
 #include "rviz/properties/vector_property.h"
 #include "rviz/properties/bool_property.h"
+#include "rviz/properties/enum_property.h"
+#include "rviz/properties/int_property.h"
 #include "rviz/properties/tf_frame_property.h"
 #include "rviz/properties/editable_enum_property.h"
 #include "rviz/properties/ros_topic_property.h"
+#include "rviz/properties/string_property.h"
 
 #include "view_controller_msgs/CameraPlacement.h"
 
@@ -55,11 +58,22 @@
 #include <OGRE/OgreSceneManager.h>
 #include <OGRE/OgreCamera.h>
 #include <OGRE/OgreRenderWindow.h>
+#include <OGRE/OgreRenderSystem.h>
+#include <OGRE/OgreRoot.h>
 
 #include <tf/transform_datatypes.h>
 #include <tf/LinearMath/Quaternion.h>
+#include <tf2_ros/buffer.h>
 #include <geometry_msgs/PoseStamped.h>
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <ctime>
+#include <sstream>
+#include <thread>
+
 namespace rviz_animated_view_controller
 {
 using namespace view_controller_msgs;
@@ -69,12 +83,27 @@ using namespace rviz;
 static const std::string MODE_ORBIT = "Orbit";
 static const std::string MODE_FPS = "FPS";
 
+// Commands the callbacks can queue in between two updates
+static const size_t CAMERA_COMMAND_QUEUE_CAPACITY = 256;
+
+// Largest credit window of acknowledged recordings, the view image publisher queues as many images per subscriber
+static const int MAX_CREDIT_WINDOW = 32;
+
 // Limits to prevent orbit controller singularity, but not currently used.
 //static const Ogre::Radian PITCH_LIMIT_LOW  = Ogre::Radian(-Ogre::Math::HALF_PI + 0.02);
 //static const Ogre::Radian PITCH_LIMIT_HIGH = Ogre::Radian( Ogre::Math::HALF_PI - 0.02);
 static const Ogre::Radian PITCH_LIMIT_LOW  = Ogre::Radian( 0.02 );
 static const Ogre::Radian PITCH_LIMIT_HIGH = Ogre::Radian( Ogre::Math::PI - 0.02);
 
+// on RViz's camera orientation, +z axis points in the focus-to-eye vector's direction, but in Gazebo
+// the camera's +x axis is expected to point towards the focus, hence the 0, pi/2, pi/2 rotation
+static Ogre::Quaternion makePublishedPoseRotation()
+{
+  tf::Quaternion rotation = tf::createQuaternionFromRPY(0.0, M_PI_2, M_PI_2);
+  return Ogre::Quaternion(rotation.w(), rotation.x(), rotation.y(), rotation.z());
+}
+static const Ogre::Quaternion PUBLISHED_POSE_ROTATION = makePublishedPoseRotation();
+
 
 // Some convenience functions for Ogre / geometry_msgs conversions
 static inline Ogre::Vector3 vectorFromMsg(const geometry_msgs::Point &m) { return Ogre::Vector3(m.x, m.y, m.z); }
@@ -100,13 +129,34 @@ static inline void vectorOgreToMsg(const Ogre::Vector3 &o, geometry_msgs::Vector
 
 AnimatedViewController::AnimatedViewController()
   : nh_("")
-    , cam_movements_buffer_(100)
+    , camera_commands_(CAMERA_COMMAND_QUEUE_CAPACITY)
+    , overflowing_camera_commands_(false)
+    , waiting_for_transform_(false)
     , animate_(false)
+    , trajectory_clock_(CLOCK_WALL)
+    , streaming_trajectory_(false)
+    , dropped_stream_keyframes_(0)
+    , published_stream_buffer_level_(0)
+    , motion_blur_frame_time_(-1.0)
+    , camera_state_active_(false)
+    , last_synced_movement_(0)
     , dragging_(false)
+    , recording_video_(false)
+    , streaming_view_images_(false)
+    , render_panel_throttled_(false)
+    , render_panel_frame_counter_(0)
+    , background_colour_(0.188f, 0.188f, 0.188f)
     , render_frame_by_frame_(false)
     , target_fps_(60)
     , rendered_frames_counter_(0)
-    , pause_animation_duration_(0.0)
+    , rendered_frames_total_(0)
+    , view_image_seq_(0)
+    , acknowledged_view_image_(0)
+    , waiting_for_acknowledgement_(false)
+    , view_image_allocations_at_start_(0)
+    , animation_paused_(false)
+    , camera_pose_published_(false)
+    , camera_pose_pending_(false)
 {
   interaction_disabled_cursor_ = makeIconCursor( "package://rviz/icons/forbidden.svg" );
 
@@ -127,6 +177,31 @@ AnimatedViewController::AnimatedViewController()
                                                  TfFrameProperty::FIXED_FRAME_STRING,
                                                  "TF frame the camera is attached to.",
                                                  this, NULL, true );
+  tf_lookahead_property_ = new BoolProperty("TF Lookahead", false,
+                                            "If enabled, the recent transforms of the Target Frame are kept and "
+                                            "animations move the camera with the frame's pose interpolated at the "
+                                            "time each frame is sampled at, instead of the latest transform. Avoids "
+                                            "jitter when following fast frames whose transforms arrive late.",
+                                            attached_frame_property_);
+  tf_history_size_property_ = new IntProperty("History Size", 16, "Number of recent transforms kept.",
+                                              tf_lookahead_property_);
+  tf_history_size_property_->setMin(2);
+  tf_history_size_property_->setMax(1000);
+  max_extrapolation_property_ = new FloatProperty("Max Extrapolation", 0.1,
+                                                  "Seconds the motion of the frame is extrapolated beyond its latest "
+                                                  "transform, after that its pose is held.",
+                                                  tf_lookahead_property_);
+  max_extrapolation_property_->setMin(0.0);
+  wait_for_transform_property_ = new BoolProperty("Wait For Transform", false,
+                                                  "If enabled, frame-by-frame renders only render a frame once the "
+                                                  "transform at its stamp is available. TF is polled every update "
+                                                  "without blocking rviz.",
+                                                  tf_lookahead_property_);
+  wait_timeout_property_ = new FloatProperty("Timeout", 1.0,
+                                             "Seconds a frame waits for its transform before the frame's pose is "
+                                             "extrapolated.",
+                                             wait_for_transform_property_);
+  wait_timeout_property_->setMin(0.0);
   eye_point_property_    = new VectorProperty( "Eye", Ogre::Vector3( 5, 5, 10 ),
                                               "Position of the camera.", this );
   focus_point_property_ = new VectorProperty( "Focus", Ogre::Vector3::ZERO,
@@ -140,6 +215,53 @@ AnimatedViewController::AnimatedViewController()
   default_transition_time_property_ = new FloatProperty( "Transition Time", 0.5,
                                                          "The default time to use for camera transitions.",
                                                          this );
+  transition_mode_property_ = new EnumProperty("Transition Mode", "Linear",
+                                               "How the camera moves between the poses of a trajectory. Linear "
+                                               "interpolates straight between consecutive poses, Spherical orbits "
+                                               "the eye around the focus and Spline moves eye and focus along a "
+                                               "smooth curve through all poses. Spherical and Spline rotate the "
+                                               "up vector.",
+                                               this);
+  transition_mode_property_->addOption("Linear", TRANSITION_LINEAR);
+  transition_mode_property_->addOption("Spherical", TRANSITION_SPHERICAL);
+  transition_mode_property_->addOption("Spline", TRANSITION_SPLINE);
+  bezier_easing_property_ = new StringProperty("Bezier Easing", "0.25, 0.1, 0.25, 1.0",
+                                               "Control points x1, y1, x2, y2 of the speed profile of movements "
+                                               "whose interpolation_speed is 6, like CSS cubic-bezier(). 4 selects "
+                                               "a cubic and 5 a quintic smoothstep.",
+                                               this, SLOT(onBezierEasingChanged()));
+  max_pose_rate_property_ = new FloatProperty("Max Pose Rate", 0.0,
+                                              "Maximum rate in Hz at which the camera pose is published on "
+                                              "/rviz/current_camera_pose, 0 for no limit. The latest pose is "
+                                              "always published eventually.",
+                                              this);
+  max_pose_rate_property_->setMin(0.0);
+  pose_change_epsilon_property_ = new FloatProperty("Pose Change Epsilon", 1e-5,
+                                                    "The camera pose is only published if its position or "
+                                                    "orientation changed by more than this since the last one.",
+                                                    this);
+  pose_change_epsilon_property_->setMin(0.0);
+  property_sync_rate_property_ = new FloatProperty("Property Sync Rate", 10.0,
+                                                   "Rate in Hz at which animations update the Eye, Focus, Up and "
+                                                   "Distance properties. The camera itself moves every frame. 0 "
+                                                   "updates them only when a movement ends.",
+                                                   this);
+  property_sync_rate_property_->setMin(0.0);
+  clock_source_property_ = new EnumProperty("Clock Source", "Wall",
+                                            "Clock trajectories are played back with. ROS Time follows the /clock "
+                                            "of bags replayed at any rate or of simulations, Frame Locked advances "
+                                            "by one frame per update. Frame-by-frame trajectories are always frame "
+                                            "locked. The clock is chosen when a trajectory starts.",
+                                            this);
+  clock_source_property_->addOption("Wall", CLOCK_WALL);
+  clock_source_property_->addOption("ROS Time", CLOCK_ROS);
+  clock_source_property_->addOption("Frame Locked", CLOCK_FRAME_LOCKED);
+  frame_locked_rate_property_ = new IntProperty("Frame Rate", 30,
+                                                "Frames per second of trajectory time rendered per update by the "
+                                                "Frame Locked clock.",
+                                                clock_source_property_);
+  frame_locked_rate_property_->setMin(1);
+  frame_locked_rate_property_->setMax(1000);
   camera_placement_topic_property_ = new RosTopicProperty("Placement Topic", "/rviz/camera_placement",
                                                           QString::fromStdString(ros::message_traits::datatype<view_controller_msgs::CameraPlacement>() ),
                                                           "Topic for CameraPlacement messages", this, SLOT(updateTopics()));
@@ -156,46 +278,759 @@ AnimatedViewController::AnimatedViewController()
   publish_view_images_property_ = new BoolProperty("Publish View Images During Animation", false, 
                                                    "If enabled, publishes images of what the user sees in the visualization window during an animation.", 
                                                    this);
+  fast_offline_render_property_ = new BoolProperty("Fast Offline Render", false,
+                                                   "If enabled, frame-by-frame trajectories are rendered, captured and "
+                                                   "published as fast as possible instead of one frame per rviz "
+                                                   "update. Requires Render Offscreen. Other displays are only "
+                                                   "updated in between time slices.",
+                                                   this);
+  offline_time_slice_property_ = new IntProperty("Time Slice", 100,
+                                                 "Milliseconds spent rendering frames before control is handed back "
+                                                 "to rviz to keep the GUI responsive.",
+                                                 fast_offline_render_property_);
+  offline_time_slice_property_->setMin(1);
+  offline_time_slice_property_->setMax(10000);
+  offscreen_only_property_ = new BoolProperty("Offscreen Only", false,
+                                              "If enabled, the render panel is never redrawn and view images are "
+                                              "only rendered offscreen, e.g. on a render farm. Frame-by-frame "
+                                              "trajectories are rendered as with Fast Offline Render, view image "
+                                              "sizes are taken from Render Offscreen. rviz still renders with the GL "
+                                              "context of its render panel, so it needs an X server, which may be a "
+                                              "virtual one, and runs in its Qt event loop.",
+                                              this, SLOT(onOffscreenOnlyChanged()));
+  view_image_capture_mode_property_ = new EnumProperty("Capture Mode", "Synchronous",
+                                                       "Synchronous reads every image back right away, which stalls the "
+                                                       "render pipeline. Async Pipelined reads back through a ring of "
+                                                       "pixel buffer objects and publishes each image a few frames later, "
+                                                       "stamped with the time it was rendered.",
+                                                       publish_view_images_property_);
+  view_image_capture_mode_property_->addOption("Synchronous", CAPTURE_SYNCHRONOUS);
+  view_image_capture_mode_property_->addOption("Async Pipelined", CAPTURE_ASYNC_PIPELINED);
+  view_image_encoding_property_ = new EnumProperty("Image Encoding", "bgr8",
+                                                   "nv12 converts the view images to YUV 4:2:0 in a shader before "
+                                                   "they are read back, which halves the transferred bytes and suits "
+                                                   "hardware video encoders. Requires Render Offscreen, bgr8 is "
+                                                   "published otherwise. Use a transport which accepts nv12, e.g. raw.",
+                                                   publish_view_images_property_);
+  view_image_encoding_property_->addOption("bgr8", IMAGE_ENCODING_BGR8);
+  view_image_encoding_property_->addOption("nv12", IMAGE_ENCODING_NV12);
+  capture_pipeline_depth_property_ = new IntProperty("Pipeline Depth", 3,
+                                                     "Number of frames in flight in the Async Pipelined capture mode.",
+                                                     publish_view_images_property_);
+  capture_pipeline_depth_property_->setMin(2);
+  capture_pipeline_depth_property_->setMax(8);
+  publish_queue_depth_property_ = new IntProperty("Publish Queue Depth", 2,
+                                                  "Number of captured images which may wait to be published. "
+                                                  "Publishing, including image_transport compression, runs on a "
+                                                  "separate thread.",
+                                                  publish_view_images_property_);
+  publish_queue_depth_property_->setMin(1);
+  publish_queue_depth_property_->setMax(64);
+  publish_queue_policy_property_ = new EnumProperty("Publish Queue Policy", "Drop Oldest",
+                                                    "What to do when the publish queue is full: drop the oldest image "
+                                                    "or block rendering until there is room. Frame-by-frame "
+                                                    "trajectories always block so that no frame is lost.",
+                                                    publish_view_images_property_);
+  publish_queue_policy_property_->addOption("Drop Oldest", ImagePublishWorker::DROP_OLDEST);
+  publish_queue_policy_property_->addOption("Block", ImagePublishWorker::BLOCK);
+  stream_view_images_property_ = new BoolProperty("Stream Continuously", false,
+                                                  "If enabled, view images are also published while no animation "
+                                                  "is running, as long as someone subscribed to them.",
+                                                  publish_view_images_property_);
+  stream_rate_property_ = new FloatProperty("Stream Rate", 30.0,
+                                            "Maximum rate of the streamed view images in Hz, 0 publishes one image "
+                                            "per rviz update.",
+                                            stream_view_images_property_);
+  stream_rate_property_->setMin(0.0);
+  render_offscreen_property_ = new BoolProperty("Render Offscreen", false,
+                                                "If enabled, view images are rendered into a texture of the given "
+                                                "size instead of being read from the visible render panel.",
+                                                publish_view_images_property_);
+  offscreen_width_property_ = new IntProperty("Image Width", 1920, "Width of the offscreen view images in pixels.",
+                                              render_offscreen_property_);
+  offscreen_width_property_->setMin(1);
+  offscreen_width_property_->setMax(16384);
+  offscreen_height_property_ = new IntProperty("Image Height", 1080, "Height of the offscreen view images in pixels.",
+                                               render_offscreen_property_);
+  offscreen_height_property_->setMin(1);
+  offscreen_height_property_->setMax(16384);
+  supersampling_property_ = new IntProperty("Supersampling", 1,
+                                            "Renders the scene at this multiple of the image size and averages "
+                                            "every block of this many pixels squared into one on the GPU.",
+                                            render_offscreen_property_);
+  supersampling_property_->setMin(1);
+  supersampling_property_->setMax(4);
+  multisampling_property_ = new IntProperty("Multisampling", 0,
+                                            "MSAA samples per pixel of the offscreen images, batch views included, 0 "
+                                            "for none. Resolved on the GPU, so unlike Supersampling it costs no "
+                                            "extra resolution.",
+                                            render_offscreen_property_);
+  multisampling_property_->setMin(0);
+  multisampling_property_->setMax(16);
+  motion_blur_samples_property_ = new IntProperty("Motion Blur Samples", 1,
+                                                  "Number of sub-frames sampled from the trajectory and averaged "
+                                                  "on the GPU into every offscreen view image of an animation, 1 "
+                                                  "for no motion blur.",
+                                                  render_offscreen_property_);
+  motion_blur_samples_property_->setMin(1);
+  motion_blur_samples_property_->setMax(64);
+  shutter_property_ = new FloatProperty("Shutter", 0.5,
+                                        "Fraction of the frame interval the sub-frames span, ending at the time of "
+                                        "the frame.",
+                                        motion_blur_samples_property_);
+  shutter_property_->setMin(0.0);
+  shutter_property_->setMax(1.0);
+  panel_frame_skip_property_ = new IntProperty("Panel Frame Skip", 0,
+                                               "Number of frames the visible render panel is not redrawn in between "
+                                               "while view images are rendered offscreen during an animation.",
+                                               render_offscreen_property_);
+  panel_frame_skip_property_->setMin(0);
+  panel_frame_skip_property_->setMax(100);
+  batch_views_property_ = new IntProperty("Batch Views", 0,
+                                          "Number of additional cameras rendered offscreen in every frame of an "
+                                          "animation. Batch view i follows the trajectories received on "
+                                          "/rviz/batch_view_<i>/camera_trajectory, sampled at the time of the main "
+                                          "trajectory, and publishes /rviz/batch_view_<i>/view_image.",
+                                          render_offscreen_property_);
+  batch_views_property_->setMin(0);
+  batch_views_property_->setMax(32);
+  downscale_property_ = new IntProperty("Downscale", 1,
+                                        "Divides width and height of the view images by this factor, filtered "
+                                        "bilinearly on the GPU before readback.",
+                                        render_offscreen_property_);
+  downscale_property_->setMin(1);
+  downscale_property_->setMax(16);
+  region_of_interest_property_ = new BoolProperty("Region Of Interest", false,
+                                                  "If enabled, view images only show the given region of the "
+                                                  "rendered image, which is all that is read back.",
+                                                  publish_view_images_property_);
+  roi_x_property_ = new IntProperty("X", 0, "Left column of the region in pixels.", region_of_interest_property_);
+  roi_x_property_->setMin(0);
+  roi_y_property_ = new IntProperty("Y", 0, "Top row of the region in pixels.", region_of_interest_property_);
+  roi_y_property_->setMin(0);
+  roi_width_property_ = new IntProperty("Width", 640, "Width of the region in pixels.", region_of_interest_property_);
+  roi_width_property_->setMin(1);
+  roi_height_property_ = new IntProperty("Height", 360, "Height of the region in pixels.",
+                                         region_of_interest_property_);
+  roi_height_property_->setMin(1);
+  preview_property_ = new BoolProperty("Preview", false,
+                                       "If enabled, a scaled down version of the whole view, rendered in the same "
+                                       "frame as the view image, is published on /rviz/view_image_preview. "
+                                       "Requires Render Offscreen.",
+                                       publish_view_images_property_);
+  preview_width_property_ = new IntProperty("Width", 320, "Width of the preview images in pixels.", preview_property_);
+  preview_width_property_->setMin(1);
+  preview_width_property_->setMax(16384);
+  preview_height_property_ = new IntProperty("Height", 180, "Height of the preview images in pixels.",
+                                             preview_property_);
+  preview_height_property_->setMin(1);
+  preview_height_property_->setMax(16384);
+  acknowledge_view_images_property_ = new BoolProperty("Wait For Acknowledgements", false,
+                                                       "If enabled, frame-by-frame renders only run ahead of the "
+                                                       "acknowledgements received on /rviz/view_image_ack by the "
+                                                       "credit window. An acknowledgement is a std_msgs/UInt32 with the "
+                                                       "header.seq of the latest view image received, which "
+                                                       "acknowledges it and all images published before it.",
+                                                       publish_view_images_property_);
+  credit_window_property_ = new IntProperty("Credit Window", 4,
+                                            "Number of view images published without being acknowledged yet.",
+                                            acknowledge_view_images_property_);
+  credit_window_property_->setMin(1);
+  credit_window_property_->setMax(MAX_CREDIT_WINDOW);
+  acknowledgement_timeout_property_ = new FloatProperty("Timeout", 10.0,
+                                                        "Seconds without acknowledgement after which the render "
+                                                        "continues, 0 to wait forever.",
+                                                        acknowledge_view_images_property_);
+  acknowledgement_timeout_property_->setMin(0.0);
+  record_video_property_ = new BoolProperty("Record Video", false,
+                                            "If enabled, frame-by-frame trajectories are encoded into a video file "
+                                            "in process, in addition to being published. /rviz/finished_animation "
+                                            "is sent once the file is complete. Requires FFmpeg at build time.",
+                                            publish_view_images_property_);
+  video_directory_property_ = new StringProperty("Directory", "/tmp",
+                                                 "Directory the rviz_animation_<date>_<time>.mp4 files are written to.",
+                                                 record_video_property_);
+  video_codec_property_ = new EditableEnumProperty("Codec", "h264_nvenc",
+                                                   "FFmpeg video encoder. Falls back to the default H.264 encoder if "
+                                                   "the selected one is not available. Select nv12 as Image Encoding "
+                                                   "to feed hardware encoders without conversion.",
+                                                   record_video_property_);
+  video_codec_property_->addOptionStd("h264_nvenc");
+  video_codec_property_->addOptionStd("hevc_nvenc");
+  video_codec_property_->addOptionStd("libx264");
+  video_codec_property_->addOptionStd("mpeg4");
+  video_bit_rate_property_ = new FloatProperty("Bit Rate", 20.0, "Target bit rate of the video in Mbit/s.",
+                                               record_video_property_);
+  video_bit_rate_property_->setMin(0.1);
+  trajectory_preview_property_ = new BoolProperty("Trajectory Preview", true,
+                                                  "CameraTrajectories received on /rviz/preview_camera_trajectory "
+                                                  "are not played. If enabled, their eye (orange) and focus (blue) "
+                                                  "paths are drawn, and a contact sheet of frames sampled across "
+                                                  "the trajectory is published on /rviz/preview_contact_sheet.",
+                                                  this, SLOT(onTrajectoryPreviewChanged()));
+  preview_path_samples_property_ = new IntProperty("Path Samples", 200,
+                                                   "Number of poses along the trajectory the paths are drawn "
+                                                   "through.",
+                                                   trajectory_preview_property_);
+  preview_path_samples_property_->setMin(2);
+  preview_path_samples_property_->setMax(100000);
+  contact_sheet_columns_property_ = new IntProperty("Columns", 4, "Number of frames per row of the contact sheet.",
+                                                    trajectory_preview_property_);
+  contact_sheet_columns_property_->setMin(1);
+  contact_sheet_columns_property_->setMax(32);
+  contact_sheet_rows_property_ = new IntProperty("Rows", 4, "Number of rows of the contact sheet.",
+                                                 trajectory_preview_property_);
+  contact_sheet_rows_property_->setMin(1);
+  contact_sheet_rows_property_->setMax(32);
+  contact_sheet_tile_width_property_ = new IntProperty("Tile Width", 320,
+                                                       "Width of a frame of the contact sheet in pixels.",
+                                                       trajectory_preview_property_);
+  contact_sheet_tile_width_property_->setMin(1);
+  contact_sheet_tile_width_property_->setMax(4096);
+  contact_sheet_tile_height_property_ = new IntProperty("Tile Height", 180,
+                                                        "Height of a frame of the contact sheet in pixels.",
+                                                        trajectory_preview_property_);
+  contact_sheet_tile_height_property_->setMin(1);
+  contact_sheet_tile_height_property_->setMax(4096);
+  trajectory_directory_property_ = new StringProperty("Trajectory Library", "",
+                                                      "Trajectories received on /rviz/store_camera_trajectory are "
+                                                      "transformed once and can be played again by sending the ID "
+                                                      "published on /rviz/stored_camera_trajectory to "
+                                                      "/rviz/play_camera_trajectory. If a directory is given here, "
+                                                      "they are also written there and survive restarts.",
+                                                      this, SLOT(onTrajectoryLibraryChanged()));
+  cached_trajectories_property_ = new IntProperty("Cached Trajectories", 16,
+                                                  "Number of stored trajectories kept in memory.",
+                                                  trajectory_directory_property_, SLOT(onTrajectoryLibraryChanged()),
+                                                  this);
+  cached_trajectories_property_->setMin(1);
+  cached_trajectories_property_->setMax(1024);
+  stream_capacity_property_ = new IntProperty("Stream Capacity", 4096,
+                                              "Maximum number of keyframes buffered for a trajectory streamed on "
+                                              "/rviz/stream_camera_trajectory. They are allocated once when the "
+                                              "stream starts, played ones are recycled. Keyframes that do not fit "
+                                              "are dropped, /rviz/stream_buffer_level reports how many wait.",
+                                              this);
+  stream_capacity_property_->setMin(2);
+  stream_capacity_property_->setMax(1000000);
+  publish_statistics_property_ = new BoolProperty("Publish Statistics", false,
+                                                  "If enabled, durations of the animation, capture and publishing "
+                                                  "hot paths are measured and published periodically on "
+                                                  "/rviz/view_controller_stats.",
+                                                  this);
+  statistics_period_property_ = new FloatProperty("Period", 1.0,
+                                                  "Seconds in between two statistics messages.",
+                                                  publish_statistics_property_);
+  statistics_period_property_->setMin(0.1);
   initializePublishers();
   initializeSubscribers();
 }
 
 AnimatedViewController::~AnimatedViewController()
 {
+    // no callback may run while the controller is torn down
+    if(callback_spinner_)
+      callback_spinner_->stop();
+    CameraCommand* command = nullptr;
+    while(camera_commands_.pop(command))
+      delete command;
+    image_publish_worker_.reset();
+    batch_views_.clear();
+    trajectory_preview_.reset();
+    offscreen_render_target_.destroy();
+    nv12_conversion_pass_.release();
+    view_image_resample_pass_.release();
+    preview_resample_pass_.release();
     delete focal_shape_;
     context_->getSceneManager()->destroySceneNode( attached_scene_node_ );
 }
 
 void AnimatedViewController::updateTopics()
 {
-  placement_subscriber_  = nh_.subscribe<view_controller_msgs::CameraPlacement>
+  placement_subscriber_  = callback_nh_.subscribe<view_controller_msgs::CameraPlacement>
                               (camera_placement_topic_property_->getStdString(), 1,
                               boost::bind(&AnimatedViewController::cameraPlacementCallback, this, _1));
   
-  trajectory_subscriber_ = nh_.subscribe<view_controller_msgs::CameraTrajectory>
+  trajectory_subscriber_ = callback_nh_.subscribe<view_controller_msgs::CameraTrajectory>
                                 (camera_trajectory_topic_property_->getStdString(), 1,
                                  boost::bind(&AnimatedViewController::cameraTrajectoryCallback, this, _1));
 }
 
 void AnimatedViewController::initializePublishers()
 {
-  current_camera_pose_publisher_ = nh_.advertise<geometry_msgs::PoseStamped>("/rviz/current_camera_pose", 1);
+  // the output manager counts the subscribers, so update() can skip outputs nobody listens to for free
+  typedef ros::SingleSubscriberPublisher Ros;
+  typedef image_transport::SingleSubscriberPublisher Transport;
+  current_camera_pose_publisher_ = nh_.advertise<geometry_msgs::PoseStamped>(
+    "/rviz/current_camera_pose", 1,
+    output_manager_.connectCallback<Ros>(OutputManager::CAMERA_POSE),
+    output_manager_.disconnectCallback<Ros>(OutputManager::CAMERA_POSE));
+  // not gated, it is sent once per animation and must not be lost while a connect callback is pending
   finished_animation_publisher_ = nh_.advertise<std_msgs::Bool>("/rviz/finished_animation", 1);
+  // latched, so the ID of the last stored trajectory reaches a client subscribing after sending it
+  stored_trajectory_publisher_ = nh_.advertise<std_msgs::String>("/rviz/stored_camera_trajectory", 1, true);
+  stream_buffer_level_publisher_ = nh_.advertise<std_msgs::UInt32>("/rviz/stream_buffer_level", 1);
+  statistics_publisher_ = nh_.advertise<diagnostic_msgs::DiagnosticArray>(
+    "/rviz/view_controller_stats", 1,
+    output_manager_.connectCallback<Ros>(OutputManager::STATISTICS),
+    output_manager_.disconnectCallback<Ros>(OutputManager::STATISTICS));
 
   image_transport::ImageTransport it(nh_);
-  camera_view_image_publisher_ = it.advertise("/rviz/view_image", 1);
+  // queues a full credit window, so an acknowledged recording never loses an image to a slow subscriber link
+  camera_view_image_publisher_ = it.advertise("/rviz/view_image", MAX_CREDIT_WINDOW,
+                                              output_manager_.connectCallback<Transport>(OutputManager::VIEW_IMAGE),
+                                              output_manager_.disconnectCallback<Transport>(OutputManager::VIEW_IMAGE));
+  preview_image_publisher_ = it.advertise("/rviz/view_image_preview", 1,
+                                          output_manager_.connectCallback<Transport>(OutputManager::PREVIEW_IMAGE),
+                                          output_manager_.disconnectCallback<Transport>(OutputManager::PREVIEW_IMAGE));
+  contact_sheet_publisher_ = it.advertise("/rviz/preview_contact_sheet", 1);
+
+  image_publish_worker_.reset(new ImagePublishWorker(
+                                [this](const sensor_msgs::ImageConstPtr& image, unsigned int stream)
+                                {
+                                  TimingStatistics::ScopedTimer timer(timing_statistics_, TimingStatistics::PUBLISH);
+                                  if(stream == PREVIEW_IMAGE_STREAM)
+                                  {
+                                    preview_image_publisher_.publish(image);
+                                    return;
+                                  }
+                                  if(stream == CONTACT_SHEET_STREAM)
+                                  {
+                                    contact_sheet_publisher_.publish(image);
+                                    return;
+                                  }
+                                  if(stream >= BATCH_VIEW_STREAM)
+                                  {
+                                    image_transport::Publisher publisher;
+                                    {
+                                      std::lock_guard<std::mutex> lock(batch_publishers_mutex_);
+                                      if(stream - BATCH_VIEW_STREAM < batch_image_publishers_.size())
+                                        publisher = batch_image_publishers_[stream - BATCH_VIEW_STREAM];
+                                    }
+                                    if(publisher)
+                                      publisher.publish(image);
+                                    return;
+                                  }
+
+                                  if(video_recorder_.isRecording())
+                                    video_recorder_.write(*image);
+                                  // publishing the pointer lets image_transport's raw publisher hand the
+                                  // pooled image to subscribers in the same process without serializing it
+                                  camera_view_image_publisher_.publish(image);
+                                }));
 }
 
 void AnimatedViewController::initializeSubscribers()
 {
-  pause_animation_duration_subscriber_ = nh_.subscribe("/rviz/pause_animation_duration", 1,
-                                                       &AnimatedViewController::pauseAnimationCallback, this);
+  // all controller subscriptions are serviced by our own spinner instead of rviz's GUI thread
+  callback_nh_.setCallbackQueue(&callback_queue_);
+
+  pause_animation_duration_subscriber_ = callback_nh_.subscribe("/rviz/pause_animation_duration", 1,
+                                                                &AnimatedViewController::pauseAnimationCallback, this);
+  pause_animation_subscriber_ = callback_nh_.subscribe("/rviz/pause_animation", 1,
+                                                       &AnimatedViewController::pauseResumeAnimationCallback, this);
+  seek_animation_subscriber_ = callback_nh_.subscribe("/rviz/seek_animation", 1,
+                                                      &AnimatedViewController::seekAnimationCallback, this);
+  preview_trajectory_subscriber_ = callback_nh_.subscribe("/rviz/preview_camera_trajectory", 1,
+                                                          &AnimatedViewController::previewTrajectoryCallback, this);
+  store_trajectory_subscriber_ = callback_nh_.subscribe("/rviz/store_camera_trajectory", 1,
+                                                        &AnimatedViewController::storeTrajectoryCallback, this);
+  play_trajectory_subscriber_ = callback_nh_.subscribe("/rviz/play_camera_trajectory", 1,
+                                                       &AnimatedViewController::playTrajectoryCallback, this);
+  view_image_ack_subscriber_ = callback_nh_.subscribe("/rviz/view_image_ack", 10,
+                                                      &AnimatedViewController::viewImageAckCallback, this);
+  // a producer streams many small messages, which must not overwrite each other before the spinner gets to them
+  stream_trajectory_subscriber_ = callback_nh_.subscribe("/rviz/stream_camera_trajectory", 100,
+                                                         &AnimatedViewController::streamTrajectoryCallback, this);
 }
 
 void AnimatedViewController::pauseAnimationCallback(const std_msgs::Duration::ConstPtr& pause_duration_msg)
 {
-  pause_animation_duration_.sec = pause_duration_msg->data.sec;
-  pause_animation_duration_.nsec = pause_duration_msg->data.nsec;
+  const ros::Duration pause_duration(pause_duration_msg->data.sec, pause_duration_msg->data.nsec);
+  if(pause_duration.toSec() <= 0.0)
+    return;
+
+  // the end of the pause is measured on the trajectory clock, which only update() knows
+  CameraCommand command(CameraCommand::PAUSE);
+  command.pause_duration = pause_duration;
+  queueCameraCommand(std::move(command));
+}
+
+void AnimatedViewController::pauseResumeAnimationCallback(const std_msgs::Bool::ConstPtr& pause_msg)
+{
+  // a zero end time pauses until resumed explicitly
+  queueCameraCommand(CameraCommand(pause_msg->data ? CameraCommand::PAUSE : CameraCommand::RESUME));
+}
+
+void AnimatedViewController::seekAnimationCallback(const std_msgs::Duration::ConstPtr& seek_msg)
+{
+  CameraCommand command(CameraCommand::SEEK);
+  command.seek_time = ros::Duration(seek_msg->data.sec, seek_msg->data.nsec);
+  queueCameraCommand(std::move(command));
+}
+
+void AnimatedViewController::viewImageAckCallback(const std_msgs::UInt32::ConstPtr& ack_msg)
+{
+  // acknowledgements are cumulative, a reordered older one must not take back credit
+  uint32_t acknowledged = acknowledged_view_image_.load(std::memory_order_relaxed);
+  while(ack_msg->data > acknowledged
+        && !acknowledged_view_image_.compare_exchange_weak(acknowledged, ack_msg->data, std::memory_order_release,
+                                                           std::memory_order_relaxed))
+  {
+  }
+}
+
+void AnimatedViewController::queueCameraCommand(CameraCommand&& command)
+{
+  // once a command overflowed, later ones must not overtake it through the queue
+  if(!overflowing_camera_commands_.load(std::memory_order_acquire))
+  {
+    std::unique_ptr<CameraCommand> queued(new CameraCommand(std::move(command)));
+    if(camera_commands_.push(queued.get()))
+    {
+      queued.release();
+      return;
+    }
+    command = std::move(*queued);
+  }
+
+  // dropping a pause, resume or seek would leave the playback in the wrong state
+  if(command.type != CameraCommand::PAUSE && command.type != CameraCommand::RESUME
+     && command.type != CameraCommand::SEEK)
+  {
+    ROS_WARN_THROTTLE(1.0, "Too many camera commands are waiting for the view controller, dropping the latest.");
+    return;
+  }
+
+  ROS_WARN_THROTTLE(1.0, "Too many camera commands are waiting for the view controller, queueing a playback "
+                         "control command separately.");
+  std::lock_guard<std::mutex> lock(overflow_camera_commands_mutex_);
+  overflow_camera_commands_.push_back(std::move(command));
+  overflowing_camera_commands_.store(true, std::memory_order_release);
+}
+
+void AnimatedViewController::applyCameraCommands()
+{
+  applyQueuedCameraCommands();
+  if(!overflowing_camera_commands_.load(std::memory_order_acquire))
+    return;
+
+  // nothing is queued while commands overflow, so what the queue holds now precedes the overflowed commands
+  applyQueuedCameraCommands();
+  std::vector<CameraCommand> overflowed;
+  {
+    std::lock_guard<std::mutex> lock(overflow_camera_commands_mutex_);
+    overflowed.swap(overflow_camera_commands_);
+    overflowing_camera_commands_.store(false, std::memory_order_release);
+  }
+  for(const CameraCommand& command : overflowed)
+    applyCameraCommand(command);
+}
+
+void AnimatedViewController::applyQueuedCameraCommands()
+{
+  CameraCommand* queued = nullptr;
+  while(camera_commands_.pop(queued))
+  {
+    std::unique_ptr<const CameraCommand> command(queued);
+    applyCameraCommand(*command);
+  }
+}
+
+void AnimatedViewController::applyCameraCommand(const CameraCommand& command)
+{
+  switch(command.type)
+  {
+    case CameraCommand::MOVE:
+      applyCameraMovements(command);
+      break;
+    case CameraCommand::PAUSE:
+      pauseAnimation();
+      pause_end_time_ = command.pause_duration.isZero() ? ros::Time() : pause_start_time_ + command.pause_duration;
+      break;
+    case CameraCommand::RESUME:
+      resumeAnimation();
+      break;
+    case CameraCommand::SEEK:
+      seekAnimation(command.seek_time);
+      break;
+    case CameraCommand::BATCH_MOVE:
+      applyBatchMovements(command);
+      break;
+    case CameraCommand::PREVIEW:
+      applyTrajectoryPreview(command);
+      break;
+    case CameraCommand::STREAM:
+      applyStreamMovements(command);
+      break;
+  }
+}
+
+void AnimatedViewController::applyCameraMovements(const CameraCommand& command)
+{
+  // the path of a previewed trajectory must not end up in the rendered or published views
+  if(trajectory_preview_)
+    trajectory_preview_->clearPath();
+
+  // Handle control parameters, properties are only touched if they change to keep their signals quiet
+  if(mouse_enabled_property_->getBool() == command.interaction_disabled)
+    mouse_enabled_property_->setBool(!command.interaction_disabled);
+  if(fixed_up_property_->getBool() == command.allow_free_yaw_axis)
+    fixed_up_property_->setBool(!command.allow_free_yaw_axis);
+  if(command.mouse_interaction_mode != view_controller_msgs::CameraTrajectory::NO_CHANGE)
+  {
+    std::string name = "";
+    if(command.mouse_interaction_mode == view_controller_msgs::CameraTrajectory::ORBIT)
+      name = MODE_ORBIT;
+    else if(command.mouse_interaction_mode == view_controller_msgs::CameraTrajectory::FPS)
+      name = MODE_FPS;
+    if(interaction_mode_property_->getStdString() != name)
+      interaction_mode_property_->setStdString(name);
+  }
+
+  if(command.render_frame_by_frame)
+  {
+    const bool starting = !render_frame_by_frame_;
+    if(starting)
+    {
+      frame_by_frame_start_time_ = ros::WallTime::now();
+      rendered_frames_total_ = 0;
+      view_image_allocations_at_start_ = view_image_pool_.getAllocations();
+      unacknowledged_view_images_.clear();
+      waiting_for_acknowledgement_ = false;
+    }
+    render_frame_by_frame_ = true;
+    target_fps_ = command.frames_per_second;
+    if(!publish_view_images_property_->getBool())
+      publish_view_images_property_->setBool(true);
+    if(starting)
+      startVideoRecording();
+  }
+
+  if(command.target_frame != "")
+  {
+    // changing the property updates the attached frame through its signal, otherwise only its pose is refreshed
+    if(attached_frame_property_->getStdString() != command.target_frame)
+      attached_frame_property_->setStdString(command.target_frame);
+    else
+      updateAttachedFrame();
+  }
+
+  // the start pose is added as well if no trajectory is playing
+  trajectory_.reserve(command.movements.size() + 1);
+
+  for(const OgreCameraMovement& movement : command.movements)
+    beginNewTransition(movement.eye, movement.focus, movement.up, ros::Duration(movement.transition_duration),
+                       movement.interpolation_speed);
+}
+
+void AnimatedViewController::applyStreamMovements(const CameraCommand& command)
+{
+  if(trajectory_.empty())
+  {
+    // all slots are allocated here, the ring then recycles played keyframes for as long as the stream runs
+    trajectory_.setMaxSize(static_cast<size_t>(stream_capacity_property_->getInt()));
+    streaming_trajectory_ = true;
+    dropped_stream_keyframes_ = 0;
+  }
+  applyCameraMovements(command);
+}
+
+void AnimatedViewController::publishStreamBufferLevel()
+{
+  const size_t level = trajectory_.getPendingKeyframes();
+  if(level == published_stream_buffer_level_)
+    return;
+
+  std_msgs::UInt32 msg;
+  msg.data = static_cast<uint32_t>(level);
+  stream_buffer_level_publisher_.publish(msg);
+  published_stream_buffer_level_ = level;
+}
+
+void AnimatedViewController::applyBatchMovements(const CameraCommand& command)
+{
+  if(command.batch_view >= batch_views_.size())
+    return;
+
+  BatchView& view = *batch_views_[command.batch_view];
+  if(view.trajectory.empty())
+  {
+    view.start_time = animate_ && isMovementAvailable() ? computeTrajectoryTime() : 0.0;
+    view.trajectory.append(view.eye, view.focus, view.up, 0.0, view_controller_msgs::CameraMovement::WAVE);
+  }
+  view.active = true;
+
+  view.trajectory.reserve(command.movements.size());
+  for(const OgreCameraMovement& movement : command.movements)
+    view.trajectory.append(movement.eye, movement.focus, movement.up, std::max(0.001, movement.transition_duration),
+                           movement.interpolation_speed);
+}
+
+void AnimatedViewController::applyTrajectoryPreview(const CameraCommand& command)
+{
+  if(!trajectory_preview_)
+    return;
+
+  // the preview is compiled like a trajectory that starts now, but never becomes the animated one
+  CompiledTrajectory trajectory;
+  const CameraState state = getCameraState();
+  trajectory.reserve(command.movements.size() + 1);
+  trajectory.append(state.eye, state.focus, state.up, 0.0, view_controller_msgs::CameraMovement::WAVE);
+  for(const OgreCameraMovement& movement : command.movements)
+    trajectory.append(movement.eye, movement.focus, movement.up, std::max(0.001, movement.transition_duration),
+                      movement.interpolation_speed);
+  if(!trajectory.hasMovement())
+    return;
+
+  const double duration = trajectory.getDuration();
+  auto samplePoses = [&](size_t count, std::vector<TrajectoryPreview::Pose>& poses)
+  {
+    sample_times_.resize(count);
+    for(size_t i = 0; i < count; ++i)
+      sample_times_[i] = count > 1 ? duration * i / (count - 1) : 0.0;
+    sampleTrajectory(trajectory);
+
+    poses.resize(count);
+    for(size_t i = 0; i < count; ++i)
+      interpolateTrajectory(trajectory, sample_movements_[i], sample_progress_[i], poses[i].eye, poses[i].focus,
+                            poses[i].up);
+  };
+
+  std::vector<TrajectoryPreview::Pose> poses;
+  samplePoses(static_cast<size_t>(preview_path_samples_property_->getInt()), poses);
+  trajectory_preview_->setPath(poses);
+
+  if(contact_sheet_publisher_.getNumSubscribers() > 0)
+  {
+    const unsigned int columns = static_cast<unsigned int>(contact_sheet_columns_property_->getInt());
+    samplePoses(columns * static_cast<size_t>(contact_sheet_rows_property_->getInt()), poses);
+
+    sensor_msgs::ImagePtr sheet(new sensor_msgs::Image());
+    {
+      TimingStatistics::ScopedTimer timer(timing_statistics_, TimingStatistics::RENDER_OFFSCREEN);
+      trajectory_preview_->renderContactSheet(poses, columns,
+                                              static_cast<unsigned int>(contact_sheet_tile_width_property_->getInt()),
+                                              static_cast<unsigned int>(contact_sheet_tile_height_property_->getInt()),
+                                              camera_, reference_orientation_, fixed_up_property_->getBool(),
+                                              getBackgroundColour(), *sheet);
+    }
+    pushViewImage(sheet, ros::Time::now(), CONTACT_SHEET_STREAM);
+  }
+
+  std::stringstream ss;
+  ss << "Previewed a trajectory of " << command.movements.size() << " movements and " << duration << " s.";
+  setStatus(QString::fromStdString(ss.str()));
+}
+
+void AnimatedViewController::updateBatchViews()
+{
+  const size_t count = static_cast<size_t>(batch_views_property_->getInt());
+  if(count == batch_views_.size())
+    return;
+
+  if(count < batch_views_.size())
+  {
+    {
+      std::lock_guard<std::mutex> lock(batch_publishers_mutex_);
+      batch_image_publishers_.resize(count);
+    }
+    batch_views_.resize(count);
+    return;
+  }
+
+  image_transport::ImageTransport it(nh_);
+  const CameraState state = getCameraState();
+  while(batch_views_.size() < count)
+  {
+    const unsigned int index = static_cast<unsigned int>(batch_views_.size());
+    std::unique_ptr<BatchView> view(new BatchView(index, context_->getSceneManager(), attached_scene_node_));
+    // until its first trajectory the view starts from the main camera
+    view->eye = state.eye;
+    view->focus = state.focus;
+    view->up = state.up;
+    view->trajectory_subscriber = callback_nh_.subscribe<view_controller_msgs::CameraTrajectory>(
+                                    BatchView::getTopicNamespace(index) + "/camera_trajectory", 1,
+                                    boost::bind(&AnimatedViewController::batchTrajectoryCallback, this, index, _1));
+    image_transport::Publisher publisher = it.advertise(BatchView::getTopicNamespace(index) + "/view_image", 1);
+    {
+      std::lock_guard<std::mutex> lock(batch_publishers_mutex_);
+      batch_image_publishers_.push_back(publisher);
+    }
+    batch_views_.push_back(std::move(view));
+  }
+}
+
+void AnimatedViewController::updateAttachedFrameSnapshot()
+{
+  // only the render thread writes the snapshot, so comparing against the published one needs no synchronization
+  const std::string& frame = attached_frame_property_->getFrameStd();
+  if(published_attached_frame_ && published_attached_frame_->frame == frame
+     && published_attached_frame_->position == reference_position_
+     && published_attached_frame_->orientation == reference_orientation_)
+    return;
+
+  std::shared_ptr<AttachedFrameSnapshot> snapshot(new AttachedFrameSnapshot());
+  snapshot->frame = frame;
+  snapshot->position = reference_position_;
+  snapshot->orientation = reference_orientation_;
+  published_attached_frame_ = snapshot;
+  std::atomic_store(&attached_frame_snapshot_, std::shared_ptr<const AttachedFrameSnapshot>(snapshot));
+}
+
+TransformCache AnimatedViewController::makeTransformCache(const std::string& target_frame)
+{
+  std::shared_ptr<const AttachedFrameSnapshot> snapshot = std::atomic_load(&attached_frame_snapshot_);
+  AttachedFrameSnapshot attached;
+  if(snapshot)
+    attached = *snapshot;
+
+  // a new target frame becomes the attached frame before the movements are applied; like updateAttachedSceneNode()
+  // we keep the previous pose if it cannot be resolved
+  if(target_frame != "" && target_frame != attached.frame)
+  {
+    attached.frame = target_frame;
+    context_->getFrameManager()->getTransform(target_frame, ros::Time(), attached.position, attached.orientation);
+  }
+
+  return TransformCache(context_->getFrameManager(), attached.frame, attached.position, attached.orientation);
+}
+
+void AnimatedViewController::pauseAnimation()
+{
+  if(animation_paused_)
+    return;
+
+  animation_paused_ = true;
+  pause_start_time_ = getClockTime();
+  setStatus("Animation paused.");
+}
+
+void AnimatedViewController::resumeAnimation()
+{
+  if(!animation_paused_)
+    return;
+
+  animation_paused_ = false;
+  // the trajectory clock did not advance while paused
+  trajectory_start_time_ += getClockTime() - pause_start_time_;
+  setStatus("Animation resumed.");
+}
+
+void AnimatedViewController::seekAnimation(const ros::Duration& trajectory_time)
+{
+  if(!isMovementAvailable())
+    return;
+
+  const double time = std::min(std::max(0.0, trajectory_time.toSec()), trajectory_.getDuration());
+
+  const ros::Time now = getClockTime();
+  trajectory_start_time_ = now - ros::Duration(time);
+  if(animation_paused_)
+    pause_start_time_ = now;
+  rendered_frames_counter_ = static_cast<int>(std::round(time * getFrameRate()));
+  // the jump is no frame interval to blur over
+  motion_blur_frame_time_ = -1.0;
 }
 
 void AnimatedViewController::onInitialize()
@@ -212,13 +1047,122 @@ void AnimatedViewController::onInitialize()
     focal_shape_->setColor(1.0f, 1.0f, 0.0f, 0.5f);
     focal_shape_->getRootNode()->setVisible(false);
 
+    trajectory_preview_.reset(new TrajectoryPreview(context_->getSceneManager(), attached_scene_node_));
+    trajectory_preview_->setPathVisible(trajectory_preview_property_->getBool());
+
     updateWindowSizeProperties();
+    updateAttachedFrameSnapshot();
+
+    // the callbacks transform into the attached frame, which needs the frame manager of the context
+    callback_spinner_.reset(new ros::AsyncSpinner(1, &callback_queue_));
+    callback_spinner_->start();
+}
+
+Ogre::RenderWindow* AnimatedViewController::getRenderWindow() const
+{
+  rviz::RenderPanel* render_panel = context_->getViewManager()->getRenderPanel();
+  return render_panel ? render_panel->getRenderWindow() : nullptr;
+}
+
+bool AnimatedViewController::isOffscreenOnly() const
+{
+  return offscreen_only_property_->getBool();
+}
+
+Ogre::ColourValue AnimatedViewController::getBackgroundColour()
+{
+  Ogre::RenderWindow* render_window = getRenderWindow();
+  if(render_window && render_window->getNumViewports() > 0)
+    background_colour_ = render_window->getViewport(0)->getBackgroundColour();
+  return background_colour_;
 }
 
 void AnimatedViewController::updateWindowSizeProperties()
 {
-  window_width_property_->setFloat(context_->getViewManager()->getRenderPanel()->getRenderWindow()->getWidth());
-  window_height_property_->setFloat(context_->getViewManager()->getRenderPanel()->getRenderWindow()->getHeight());
+  Ogre::RenderWindow* render_window = getRenderWindow();
+  // without a panel the view images have the offscreen size
+  const unsigned int width = render_window && !isOffscreenOnly() ? render_window->getWidth()
+                                                            : static_cast<unsigned int>(offscreen_width_property_->getInt());
+  const unsigned int height = render_window && !isOffscreenOnly() ? render_window->getHeight()
+                                                             : static_cast<unsigned int>(offscreen_height_property_->getInt());
+
+  // avoid emitting property changes every frame
+  if(window_width_property_->getFloat() != width)
+    window_width_property_->setFloat(width);
+  if(window_height_property_->getFloat() != height)
+    window_height_property_->setFloat(height);
+}
+
+void AnimatedViewController::configureViewImagePool()
+{
+  unsigned int width = static_cast<unsigned int>(offscreen_width_property_->getInt());
+  unsigned int height = static_cast<unsigned int>(offscreen_height_property_->getInt());
+  Ogre::RenderWindow* render_window = getRenderWindow();
+  if(!render_offscreen_property_->getBool() && render_window)
+  {
+    width = render_window->getWidth();
+    height = render_window->getHeight();
+  }
+
+  if(isNv12ViewImage())
+  {
+    // one byte per pixel for the luma plane, followed by half as many rows of interleaved chroma
+    view_image_pool_.configure(nv12_conversion_pass_.getWidth(), nv12_conversion_pass_.getHeight(),
+                               Nv12ConversionPass::ENCODING, 1, nv12_conversion_pass_.getHeight() * 3 / 2);
+    return;
+  }
+
+  if(isResampledViewImage())
+  {
+    width = view_image_resample_pass_.getWidth();
+    height = view_image_resample_pass_.getHeight();
+  }
+  else if(!render_offscreen_property_->getBool())
+  {
+    // the render window is cropped during readback
+    unsigned int x, y;
+    getRegionOfInterest(width, height, x, y, width, height);
+  }
+
+  view_image_pool_.configure(width, height, sensor_msgs::image_encodings::BGR8,
+                             Ogre::PixelUtil::getNumElemBytes(Ogre::PF_BYTE_BGR));
+}
+
+bool AnimatedViewController::isNv12ViewImage() const
+{
+  return view_image_encoding_property_->getOptionInt() == IMAGE_ENCODING_NV12 && render_offscreen_property_->getBool()
+         && !nv12_conversion_pass_.hasFailed();
+}
+
+bool AnimatedViewController::isResampledViewImage() const
+{
+  return (region_of_interest_property_->getBool() || downscale_property_->getInt() > 1)
+         && render_offscreen_property_->getBool() && !view_image_resample_pass_.hasFailed();
+}
+
+bool AnimatedViewController::isPreviewImage() const
+{
+  return preview_property_->getBool() && render_offscreen_property_->getBool() && !preview_resample_pass_.hasFailed();
+}
+
+bool AnimatedViewController::getRegionOfInterest(unsigned int image_width, unsigned int image_height,
+                                                 unsigned int& x, unsigned int& y,
+                                                 unsigned int& width, unsigned int& height) const
+{
+  if(!region_of_interest_property_->getBool() || image_width == 0 || image_height == 0)
+  {
+    x = 0;
+    y = 0;
+    width = image_width;
+    height = image_height;
+    return false;
+  }
+
+  x = std::min(static_cast<unsigned int>(roi_x_property_->getInt()), image_width - 1);
+  y = std::min(static_cast<unsigned int>(roi_y_property_->getInt()), image_height - 1);
+  width = std::min(static_cast<unsigned int>(roi_width_property_->getInt()), image_width - x);
+  height = std::min(static_cast<unsigned int>(roi_height_property_->getInt()), image_height - y);
+  return true;
 }
 
 void AnimatedViewController::onActivate()
@@ -274,6 +1218,31 @@ void AnimatedViewController::onDistancePropertyChanged()
   connectPositionProperties();
 }
 
+void AnimatedViewController::onBezierEasingChanged()
+{
+  if(!bezier_easing_.parse(bezier_easing_property_->getStdString()))
+    setStatus("Bezier Easing needs four numbers: x1, y1, x2, y2, keeping the previous curve.");
+}
+
+void AnimatedViewController::onTrajectoryPreviewChanged()
+{
+  if(trajectory_preview_)
+    trajectory_preview_->setPathVisible(trajectory_preview_property_->getBool());
+}
+
+void AnimatedViewController::onTrajectoryLibraryChanged()
+{
+  trajectory_library_.setDirectory(trajectory_directory_property_->getStdString());
+  trajectory_library_.setCapacity(static_cast<size_t>(cached_trajectories_property_->getInt()));
+}
+
+void AnimatedViewController::onOffscreenOnlyChanged()
+{
+  if(offscreen_only_property_->getBool())
+    render_offscreen_property_->setBool(true);
+  render_offscreen_property_->setReadOnly(offscreen_only_property_->getBool());
+}
+
 void AnimatedViewController::onUpPropertyChanged()
 {
   disconnect( up_vector_property_,   SIGNAL( changed() ), this, SLOT( onUpPropertyChanged() ));
@@ -293,6 +1262,9 @@ void AnimatedViewController::onUpPropertyChanged()
 
 void AnimatedViewController::updateAttachedFrame()
 {
+  // the pose is re-expressed in the new frame, so the properties have to hold the one currently shown
+  syncPropertiesFromCameraState();
+
   Ogre::Vector3 old_position = attached_scene_node_->getPosition();
   Ogre::Quaternion old_orientation = attached_scene_node_->getOrientation();
 
@@ -317,6 +1289,88 @@ void AnimatedViewController::updateAttachedSceneNode()
     queue = true;
   }
   if(queue) context_->queueRender();
+
+  if(!tf_lookahead_property_->getBool())
+    return;
+
+  attached_frame_history_.setFrames(context_->getFrameManager()->getFixedFrame(),
+                                    attached_frame_property_->getFrameStd());
+  attached_frame_history_.setCapacity(static_cast<size_t>(tf_history_size_property_->getInt()));
+  ros::Time stamp;
+  if(lookupAttachedFrame(ros::Time(), stamp, new_reference_position, new_reference_orientation))
+    attached_frame_history_.add(stamp, new_reference_position, new_reference_orientation);
+}
+
+bool AnimatedViewController::lookupAttachedFrame(const ros::Time& time, ros::Time& stamp,
+                                                 Ogre::Vector3& position, Ogre::Quaternion& orientation)
+{
+  std::shared_ptr<tf2_ros::Buffer> buffer = context_->getFrameManager()->getTF2BufferPtr();
+  const std::string& fixed_frame = context_->getFrameManager()->getFixedFrame();
+  const std::string& frame = attached_frame_property_->getFrameStd();
+  if(!buffer || frame == fixed_frame)
+    return false;
+
+  geometry_msgs::TransformStamped transform;
+  try
+  {
+    transform = buffer->lookupTransform(fixed_frame, frame, time);
+  }
+  catch(const tf2::TransformException&)
+  {
+    return false;
+  }
+
+  stamp = transform.header.stamp;
+  position = Ogre::Vector3(transform.transform.translation.x, transform.transform.translation.y,
+                           transform.transform.translation.z);
+  orientation = Ogre::Quaternion(transform.transform.rotation.w, transform.transform.rotation.x,
+                                 transform.transform.rotation.y, transform.transform.rotation.z);
+  return true;
+}
+
+bool AnimatedViewController::updateReferencePose(const ros::Time& stamp)
+{
+  if(!tf_lookahead_property_->getBool())
+    return true;
+
+  Ogre::Vector3 position;
+  Ogre::Quaternion orientation;
+  bool exact = false;
+  if(render_frame_by_frame_ && wait_for_transform_property_->getBool()
+     && attached_frame_property_->getFrameStd() != context_->getFrameManager()->getFixedFrame())
+  {
+    std::shared_ptr<tf2_ros::Buffer> buffer = context_->getFrameManager()->getTF2BufferPtr();
+    ros::Time transform_stamp;
+    // canTransform() without timeout only checks the buffer, the frame is retried by the next update()
+    exact = buffer && buffer->canTransform(context_->getFrameManager()->getFixedFrame(),
+                                           attached_frame_property_->getFrameStd(), stamp)
+            && lookupAttachedFrame(stamp, transform_stamp, position, orientation);
+    if(!exact)
+    {
+      const ros::WallTime now = ros::WallTime::now();
+      if(!waiting_for_transform_)
+      {
+        waiting_for_transform_ = true;
+        transform_wait_start_time_ = now;
+      }
+      if((now - transform_wait_start_time_).toSec() < wait_timeout_property_->getFloat())
+        return false;
+
+      ROS_WARN_STREAM_THROTTLE(1.0, "Transform of '" << attached_frame_property_->getFrameStd() << "' at "
+                               << stamp << " did not arrive in time, extrapolating it.");
+    }
+  }
+  waiting_for_transform_ = false;
+
+  // until the first transform is recorded the camera stays attached to the latest pose
+  if(!exact && !attached_frame_history_.lookup(stamp, max_extrapolation_property_->getFloat(), position, orientation))
+    return true;
+
+  attached_scene_node_->setPosition(position);
+  attached_scene_node_->setOrientation(orientation);
+  reference_position_ = position;
+  reference_orientation_ = orientation;
+  return true;
 }
 
 void AnimatedViewController::onAttachedFrameChanged(const Ogre::Vector3& old_reference_position, const Ogre::Quaternion& old_reference_orientation)
@@ -488,20 +1542,49 @@ void AnimatedViewController::handleMouseEvent(ViewportMouseEvent& event)
 
 void AnimatedViewController::publishCameraPose()
 {
-  ros::Time current_time = ros::Time::now();
-  Ogre::Vector3 camera_position = eye_point_property_->getVector();
+  if(!output_manager_.hasSubscribers(OutputManager::CAMERA_POSE))
+  {
+    camera_pose_pending_ = false;
+    return;
+  }
 
-  // on RViz's camera orientation, +z axis points in the focus-to-eye vector's direction, but in Gazebo
-  // the camera's +x axis is expected to point towards the focus, hence the 0, pi/2, pi/2 rotation
-  tf::Quaternion invQ_tf = tf::createQuaternionFromRPY(0.0, M_PI_2, M_PI_2);
-  Ogre::Quaternion invQ(invQ_tf.w(), invQ_tf.x(), invQ_tf.y(), invQ_tf.z());
-  Ogre::Quaternion camera_orientation = getOrientation() * invQ;
+  Ogre::Vector3 camera_position = getCameraState().eye;
+  Ogre::Quaternion camera_orientation = getOrientation() * PUBLISHED_POSE_ROTATION;
   camera_orientation.normalise();
+
+  // skip poses which do not differ from the last published one
+  const double epsilon = pose_change_epsilon_property_->getFloat();
+  const std::string& frame_id = attached_frame_property_->getFrameStd();
+  if(camera_pose_published_ && frame_id == last_published_frame_id_
+     && camera_position.distance(last_published_position_) <= epsilon
+     && 1.0 - std::abs(camera_orientation.Dot(last_published_orientation_)) <= epsilon)
+  {
+    camera_pose_pending_ = false;
+    return;
+  }
+
+  // keep the pose pending if it comes too early, so the last pose of a movement is published nevertheless
+  const ros::WallTime now = ros::WallTime::now();
+  const double max_rate = max_pose_rate_property_->getFloat();
+  if(max_rate > 0.0 && camera_pose_published_ && (now - last_pose_publish_time_).toSec() < 1.0 / max_rate)
+  {
+    camera_pose_pending_ = true;
+    return;
+  }
+
+  camera_pose_published_ = true;
+  camera_pose_pending_ = false;
+  last_pose_publish_time_ = now;
+  last_published_position_ = camera_position;
+  last_published_orientation_ = camera_orientation;
+  last_published_frame_id_ = frame_id;
+
+  ros::Time current_time = ros::Time::now();
   //  ROS_INFO("eye position is x: %f y: %f z: %f", camera_target.x - camera_position.x, camera_target.y - camera_position.y, camera_target.z - camera_position.z);
   //  ROS_INFO("eye orientation is x: %f y: %f z: %f w: %f", camera_orientation.x, camera_orientation.y, camera_orientation.z, camera_orientation.w);
   geometry_msgs::PoseStamped camera_view;
   camera_view.header.stamp = current_time;
-  camera_view.header.frame_id = attached_frame_property_->getFrameStd();
+  camera_view.header.frame_id = frame_id;
   camera_view.pose.position.x = camera_position.x;
   camera_view.pose.position.y = camera_position.y;
   camera_view.pose.position.z = camera_position.z;
@@ -597,157 +1680,317 @@ void AnimatedViewController::beginNewTransition(const Ogre::Vector3 &eye,
   if(transition_duration.isZero())
     transition_duration = ros::Duration(0.001);
 
-  // if the buffer is empty we set the first element in it to the current camera pose
-  if(cam_movements_buffer_.empty())
+  if(trajectory_.isFull())
   {
-    transition_start_time_ = ros::WallTime::now();
-
-    cam_movements_buffer_.push_back(std::move(OgreCameraMovement(eye_point_property_->getVector(),
-                                                                 focus_point_property_->getVector(),
-                                                                 up_vector_property_->getVector(),
-                                                                 ros::Duration(0.001),
-                                                                 interpolation_speed))); // interpolation_speed doesn't make a difference for very short times
+    dropped_stream_keyframes_++;
+    ROS_WARN_THROTTLE(1.0, "The streamed trajectory is full, dropping camera movements. "
+                           "Throttle the stream according to /rviz/stream_buffer_level.");
+    return;
   }
 
-  if(cam_movements_buffer_.full())
-    cam_movements_buffer_.set_capacity(cam_movements_buffer_.capacity() + 20);
+  // if the trajectory is empty we start it from the current camera pose
+  if(trajectory_.empty())
+  {
+    trajectory_clock_ = static_cast<ClockSource>(clock_source_property_->getOptionInt());
+    trajectory_start_time_ = getClockTime();
+    trajectory_start_stamp_ = ros::Time::now();
+    if(animation_paused_)
+      pause_start_time_ = trajectory_start_time_;
+    rendered_frames_counter_ = 0;
+    motion_blur_frame_time_ = -1.0;
+
+    trajectory_.append(eye_point_property_->getVector(),
+                       focus_point_property_->getVector(),
+                       up_vector_property_->getVector(),
+                       0.0,
+                       interpolation_speed);
+  }
 
-  cam_movements_buffer_.push_back(std::move(OgreCameraMovement(eye, focus, up, transition_duration, interpolation_speed)));
+  trajectory_.append(eye, focus, up, transition_duration.toSec(), interpolation_speed);
 
   animate_ = true;
 }
 
 void AnimatedViewController::cancelTransition()
 {
+  // whoever takes over from here, e.g. the mouse, starts from the pose that was shown last
+  syncPropertiesFromCameraState();
+  camera_state_active_ = false;
+
   animate_ = false;
 
-  cam_movements_buffer_.clear();
+  trajectory_.clear();
   rendered_frames_counter_ = 0;
+  animation_paused_ = false;
+  if(streaming_trajectory_)
+  {
+    trajectory_.setMaxSize(0);
+    streaming_trajectory_ = false;
+    publishStreamBufferLevel();
+  }
+
+  // images still in flight belong to the animation that just finished
+  publishPendingViewImages(true);
+  for(const std::unique_ptr<BatchView>& view : batch_views_)
+  {
+    view->trajectory.clear();
+    view->active = false;
+  }
 
   if(render_frame_by_frame_)
   {
-    std_msgs::Bool finished_animation;
-    finished_animation.data = 1;  // set to true, but std_msgs::Bool is uint8 internally
-    finished_animation_publisher_.publish(finished_animation);
+    reportFrameByFrameThroughput();
+
+    // signal the end only after the worker published all images of the animation and finished the video
+    const bool recording_video = recording_video_;
+    recording_video_ = false;
+    image_publish_worker_->post([this, recording_video]()
+    {
+      if(recording_video)
+        video_recorder_.stop();
+
+      std_msgs::Bool finished_animation;
+      finished_animation.data = 1;  // set to true, but std_msgs::Bool is uint8 internally
+      finished_animation_publisher_.publish(finished_animation);
+    });
     render_frame_by_frame_ = false;
   }
 }
 
-void AnimatedViewController::cameraPlacementCallback(const CameraPlacementConstPtr &cp_ptr)
+void AnimatedViewController::startVideoRecording()
 {
-  CameraPlacement cp = *cp_ptr;
+  if(!record_video_property_->getBool())
+    return;
 
-  // Handle control parameters
-  mouse_enabled_property_->setBool( !cp.interaction_disabled );
-  fixed_up_property_->setBool( !cp.allow_free_yaw_axis );
-  if(cp.mouse_interaction_mode != cp.NO_CHANGE)
-  {
-    std::string name = "";
-    if(cp.mouse_interaction_mode == cp.ORBIT) name = MODE_ORBIT;
-    else if(cp.mouse_interaction_mode == cp.FPS) name = MODE_FPS;
-    interaction_mode_property_->setStdString(name);
-  }
+  // with milliseconds, recordings started within the same second do not overwrite each other
+  char date[32];
+  const ros::WallTime wall_now = ros::WallTime::now();
+  const time_t now = static_cast<time_t>(wall_now.sec);
+  const size_t length = strftime(date, sizeof(date), "%Y%m%d_%H%M%S", localtime(&now));
+  snprintf(date + length, sizeof(date) - length, "_%03u", wall_now.nsec / 1000000u);
+
+  VideoRecorder::Options options;
+  options.file_name = video_directory_property_->getStdString() + "/rviz_animation_" + date + ".mp4";
+  options.codec = video_codec_property_->getStdString();
+  options.frames_per_second = target_fps_;
+  options.bit_rate = static_cast<long>(video_bit_rate_property_->getFloat() * 1e6);
+
+  recording_video_ = true;
+  image_publish_worker_->post([this, options](){ video_recorder_.start(options); });
+}
 
-  if(cp.target_frame != "")
-  {
-    attached_frame_property_->setStdString(cp.target_frame);
-    updateAttachedFrame();
-  }
+void AnimatedViewController::reportFrameByFrameThroughput()
+{
+  const double elapsed = (ros::WallTime::now() - frame_by_frame_start_time_).toSec();
+  if(elapsed <= 0.0)
+    return;
+
+  std::stringstream ss;
+  ss << "Rendered " << rendered_frames_total_ << " frames in " << elapsed << " s ("
+     << rendered_frames_total_ / elapsed << " fps)";
+  ROS_INFO_STREAM(ss.str() << ", " << view_image_pool_.getAllocations() - view_image_allocations_at_start_
+                  << " image buffer allocations, " << image_publish_worker_->getDroppedImages() << " images dropped "
+                  << "by the publish queue and " << pbo_frame_grabber_.getDroppedFrames() << " by the capture pipeline "
+                  << "since startup.");
+  setStatus(QString::fromStdString(ss.str()));
+}
+
+void AnimatedViewController::cameraPlacementCallback(const CameraPlacementConstPtr &cp_ptr)
+{
+  TimingStatistics::ScopedTimer timer(timing_statistics_, TimingStatistics::PLACEMENT_CALLBACK);
+  CameraPlacement cp = *cp_ptr;
+
+  // CameraPlacement uses the same interaction mode constants as CameraTrajectory
+  CameraCommand command(CameraCommand::MOVE);
+  command.interaction_disabled = cp.interaction_disabled;
+  command.allow_free_yaw_axis = cp.allow_free_yaw_axis;
+  command.mouse_interaction_mode = cp.mouse_interaction_mode;
+  command.target_frame = cp.target_frame;
 
   if(cp.time_from_start.toSec() >= 0)
   {
     ROS_DEBUG_STREAM("Received a camera placement request! \n" << cp);
+    TransformCache transform_cache = makeTransformCache(cp.target_frame);
     transformCameraToAttachedFrame(cp.eye,
                                    cp.focus,
-                                   cp.up);
+                                   cp.up,
+                                   transform_cache);
     ROS_DEBUG_STREAM("After transform, we have \n" << cp);
 
-    Ogre::Vector3 eye = vectorFromMsg(cp.eye.point);
-    Ogre::Vector3 focus = vectorFromMsg(cp.focus.point);
-    Ogre::Vector3 up = vectorFromMsg(cp.up.vector);
-
-    beginNewTransition(eye, focus, up, cp.time_from_start);
+    OgreCameraMovement movement;
+    movement.eye = vectorFromMsg(cp.eye.point);
+    movement.focus = vectorFromMsg(cp.focus.point);
+    movement.up = vectorFromMsg(cp.up.vector);
+    movement.transition_duration = cp.time_from_start.toSec();
+    movement.interpolation_speed = view_controller_msgs::CameraMovement::WAVE;
+    command.movements.push_back(movement);
   }
+
+  queueCameraCommand(std::move(command));
+}
+
+void AnimatedViewController::batchTrajectoryCallback(unsigned int view,
+                                                     const view_controller_msgs::CameraTrajectoryConstPtr& ct_ptr)
+{
+  TimingStatistics::ScopedTimer timer(timing_statistics_, TimingStatistics::TRAJECTORY_CALLBACK);
+  view_controller_msgs::CameraTrajectory ct = *ct_ptr;
+
+  if(ct.trajectory.empty())
+    return;
+
+  if(ct.target_frame != "")
+    ROS_WARN_ONCE("Batch views are attached to the Target Frame of the main view, their target_frame is ignored.");
+
+  CameraCommand command(CameraCommand::BATCH_MOVE);
+  command.batch_view = view;
+  TransformCache transform_cache = makeTransformCache("");
+  convertCameraMovements(ct, transform_cache, command.movements);
+
+  queueCameraCommand(std::move(command));
+}
+
+void AnimatedViewController::previewTrajectoryCallback(const view_controller_msgs::CameraTrajectoryConstPtr& ct_ptr)
+{
+  TimingStatistics::ScopedTimer timer(timing_statistics_, TimingStatistics::TRAJECTORY_CALLBACK);
+  view_controller_msgs::CameraTrajectory ct = *ct_ptr;
+
+  if(ct.trajectory.empty())
+    return;
+
+  if(ct.target_frame != "")
+    ROS_WARN_ONCE("Previews are drawn in the Target Frame of the view, the target_frame of the trajectory is ignored.");
+
+  CameraCommand command(CameraCommand::PREVIEW);
+  TransformCache transform_cache = makeTransformCache("");
+  convertCameraMovements(ct, transform_cache, command.movements);
+
+  queueCameraCommand(std::move(command));
 }
 
 void AnimatedViewController::cameraTrajectoryCallback(const view_controller_msgs::CameraTrajectoryConstPtr& ct_ptr)
 {
+  TimingStatistics::ScopedTimer timer(timing_statistics_, TimingStatistics::TRAJECTORY_CALLBACK);
   view_controller_msgs::CameraTrajectory ct = *ct_ptr;
 
   if(ct.trajectory.empty())
     return;
 
-  // Handle control parameters
-  mouse_enabled_property_->setBool(!ct.interaction_disabled);
-  fixed_up_property_->setBool(!ct.allow_free_yaw_axis);
-  if(ct.mouse_interaction_mode != view_controller_msgs::CameraTrajectory::NO_CHANGE)
-  {
-    std::string name = "";
-    if(ct.mouse_interaction_mode == view_controller_msgs::CameraTrajectory::ORBIT)
-      name = MODE_ORBIT;
-    else if(ct.mouse_interaction_mode == view_controller_msgs::CameraTrajectory::FPS)
-      name = MODE_FPS;
-    interaction_mode_property_->setStdString(name);
-  }
+  CameraCommand command(CameraCommand::MOVE);
+  convertCameraTrajectory(ct, command);
+  queueCameraCommand(std::move(command));
+}
 
-  if(ct.render_frame_by_frame > 0)
+void AnimatedViewController::streamTrajectoryCallback(const view_controller_msgs::CameraTrajectoryConstPtr& ct_ptr)
+{
+  TimingStatistics::ScopedTimer timer(timing_statistics_, TimingStatistics::TRAJECTORY_CALLBACK);
+  view_controller_msgs::CameraTrajectory ct = *ct_ptr;
+
+  if(ct.trajectory.empty())
+    return;
+
+  CameraCommand command(CameraCommand::STREAM);
+  convertCameraTrajectory(ct, command);
+  queueCameraCommand(std::move(command));
+}
+
+void AnimatedViewController::storeTrajectoryCallback(const view_controller_msgs::CameraTrajectoryConstPtr& ct_ptr)
+{
+  TimingStatistics::ScopedTimer timer(timing_statistics_, TimingStatistics::TRAJECTORY_CALLBACK);
+  view_controller_msgs::CameraTrajectory ct = *ct_ptr;
+
+  if(ct.trajectory.empty())
+    return;
+
+  CameraCommand command(CameraCommand::MOVE);
+  convertCameraTrajectory(ct, command);
+  if(command.movements.empty())
+    return;
+
+  std_msgs::String id;
+  id.data = trajectory_library_.store(command);
+  ROS_INFO("Stored a camera trajectory of %zu movements as %s.", command.movements.size(), id.data.c_str());
+  stored_trajectory_publisher_.publish(id);
+}
+
+void AnimatedViewController::playTrajectoryCallback(const std_msgs::String::ConstPtr& id_msg)
+{
+  std::shared_ptr<const CameraCommand> stored = trajectory_library_.find(id_msg->data);
+  if(!stored)
   {
-    render_frame_by_frame_ = true;
-    target_fps_ = static_cast<int>(ct.frames_per_second);
-    publish_view_images_property_->setBool(true);
+    ROS_WARN("No camera trajectory is stored as %s.", id_msg->data.c_str());
+    return;
   }
 
+  // the movements were transformed when the trajectory was stored, only the command is copied
+  queueCameraCommand(CameraCommand(*stored));
+}
+
+void AnimatedViewController::convertCameraTrajectory(view_controller_msgs::CameraTrajectory& ct,
+                                                     CameraCommand& command)
+{
+  command.interaction_disabled = ct.interaction_disabled;
+  command.allow_free_yaw_axis = ct.allow_free_yaw_axis;
+  command.mouse_interaction_mode = ct.mouse_interaction_mode;
+  command.target_frame = ct.target_frame;
+  command.render_frame_by_frame = ct.render_frame_by_frame > 0;
+  command.frames_per_second = static_cast<int>(ct.frames_per_second);
+
+  // all movements are resolved against the same attached frame pose, each source frame is looked up once
+  TransformCache transform_cache = makeTransformCache(ct.target_frame);
+  convertCameraMovements(ct, transform_cache, command.movements);
+}
+
+void AnimatedViewController::convertCameraMovements(view_controller_msgs::CameraTrajectory& ct,
+                                                    TransformCache& transform_cache,
+                                                    std::vector<OgreCameraMovement>& movements)
+{
+  movements.reserve(ct.trajectory.size());
   for(auto& cam_movement : ct.trajectory)
   {
     if(cam_movement.transition_duration.toSec() >= 0.0)
     {
-      if(ct.target_frame != "")
-      {
-        attached_frame_property_->setStdString(ct.target_frame);
-        updateAttachedFrame();
-      }
-
       transformCameraToAttachedFrame(cam_movement.eye,
                                      cam_movement.focus,
-                                     cam_movement.up);
-
-      Ogre::Vector3 eye = vectorFromMsg(cam_movement.eye.point);
-      Ogre::Vector3 focus = vectorFromMsg(cam_movement.focus.point);
-      Ogre::Vector3 up = vectorFromMsg(cam_movement.up.vector);
-      beginNewTransition(eye, focus, up, cam_movement.transition_duration, cam_movement.interpolation_speed);
+                                     cam_movement.up,
+                                     transform_cache);
+
+      OgreCameraMovement movement;
+      movement.eye = vectorFromMsg(cam_movement.eye.point);
+      movement.focus = vectorFromMsg(cam_movement.focus.point);
+      movement.up = vectorFromMsg(cam_movement.up.vector);
+      movement.transition_duration = cam_movement.transition_duration.toSec();
+      movement.interpolation_speed = cam_movement.interpolation_speed;
+      movements.push_back(movement);
     }
     else
     {
       ROS_WARN("Transition duration of camera movement is below zero. Skipping that movement.");
     }
   }
+  ROS_DEBUG_STREAM("Resolved " << transform_cache.getResolvedTransforms() << " transforms for "
+                   << ct.trajectory.size() << " camera movements.");
 }
 
 void AnimatedViewController::transformCameraToAttachedFrame(geometry_msgs::PointStamped& eye,
                                                             geometry_msgs::PointStamped& focus,
-                                                            geometry_msgs::Vector3Stamped& up)
+                                                            geometry_msgs::Vector3Stamped& up,
+                                                            TransformCache& transform_cache)
 {
-  Ogre::Vector3 position_fixed_eye, position_fixed_focus, position_fixed_up;
-  Ogre::Quaternion rotation_fixed_eye, rotation_fixed_focus, rotation_fixed_up;
-
-  context_->getFrameManager()->getTransform(eye.header.frame_id,   ros::Time(0), position_fixed_eye,   rotation_fixed_eye);
-  context_->getFrameManager()->getTransform(focus.header.frame_id, ros::Time(0), position_fixed_focus, rotation_fixed_focus);
-  context_->getFrameManager()->getTransform(up.header.frame_id,    ros::Time(0), position_fixed_up,    rotation_fixed_up);
-
+  TimingStatistics::ScopedTimer timer(timing_statistics_, TimingStatistics::TRANSFORM);
   Ogre::Vector3 ogre_eye = vectorFromMsg(eye.point);
   Ogre::Vector3 ogre_focus = vectorFromMsg(focus.point);
   Ogre::Vector3 ogre_up = vectorFromMsg(up.vector);
 
-  ogre_eye = fixedFrameToAttachedLocal(position_fixed_eye + rotation_fixed_eye * ogre_eye);
-  ogre_focus = fixedFrameToAttachedLocal(position_fixed_focus + rotation_fixed_focus * ogre_focus);
-  ogre_up = reference_orientation_.Inverse() * rotation_fixed_up * ogre_up;
+  ogre_eye = transform_cache.lookup(eye.header.frame_id).transformPoint(ogre_eye);
+  ogre_focus = transform_cache.lookup(focus.header.frame_id).transformPoint(ogre_focus);
+  ogre_up = transform_cache.lookup(up.header.frame_id).transformVector(ogre_up);
 
   eye.point = pointOgreToMsg(ogre_eye);
   focus.point = pointOgreToMsg(ogre_focus);
   up.vector = vectorOgreToMsg(ogre_up);
-  eye.header.frame_id = attached_frame_property_->getStdString();
-  focus.header.frame_id = attached_frame_property_->getStdString();
-  up.header.frame_id = attached_frame_property_->getStdString();
+  eye.header.frame_id = transform_cache.getAttachedFrame();
+  focus.header.frame_id = transform_cache.getAttachedFrame();
+  up.header.frame_id = transform_cache.getAttachedFrame();
 }
 
 // We must assume that this point is in the Rviz Fixed frame since it came from Rviz...
@@ -783,169 +2026,821 @@ void AnimatedViewController::moveEyeWithFocusTo( const Ogre::Vector3& point)
 
 void AnimatedViewController::update(float dt, float ros_dt)
 {
+  timing_statistics_.setEnabled(publish_statistics_property_->getBool()
+                                && output_manager_.hasSubscribers(OutputManager::STATISTICS));
+  TimingStatistics::ScopedTimer timer(timing_statistics_, TimingStatistics::UPDATE);
+
   updateAttachedSceneNode();
+  updateBatchViews();
+  applyCameraCommands();
+  updateAttachedFrameSnapshot();
 
-  if(animate_ && isMovementAvailable())
+  if(animate_ && isMovementAvailable() && !updatePauseState() && !waitForAcknowledgements())
+  {
+    // offscreen only, nothing but the view images is rendered, so there is no reason to wait for the next update
+    if((fast_offline_render_property_->getBool() || isOffscreenOnly()) && render_frame_by_frame_)
+      renderFramesOffline();
+    else
+      updateAnimation();
+  }
+  if(streaming_trajectory_)
+    publishStreamBufferLevel();
+  updateCamera();
+  streamViewImages();
+  updateWindowSizeProperties();
+  throttleRenderPanel();
+  if(output_manager_.takeNewSubscriber(OutputManager::CAMERA_POSE))
   {
-    pauseAnimationOnRequest();
+    // a new subscriber gets the current pose, even if it did not change since the last one was published
+    camera_pose_published_ = false;
+    camera_pose_pending_ = true;
+  }
+  if(camera_pose_pending_)
+    publishCameraPose();
+  publishStatistics();
+}
 
-    auto start = cam_movements_buffer_.begin();
-    auto goal = ++(cam_movements_buffer_.begin());
+void AnimatedViewController::publishStatistics()
+{
+  if(!timing_statistics_.isEnabled())
+    return;
+
+  const ros::WallTime now = ros::WallTime::now();
+  if((now - last_statistics_time_).toSec() < statistics_period_property_->getFloat())
+    return;
+  last_statistics_time_ = now;
+
+  diagnostic_msgs::DiagnosticArray diagnostics;
+  diagnostics.header.stamp = ros::Time::now();
+  timing_statistics_.appendDiagnostics(diagnostics);
+
+  diagnostic_msgs::DiagnosticStatus frames;
+  frames.name = "rviz_animated_view_controller: view images";
+  const unsigned long dropped = image_publish_worker_->getDroppedImages() + pbo_frame_grabber_.getDroppedFrames();
+  frames.level = dropped > 0 ? diagnostic_msgs::DiagnosticStatus::WARN : diagnostic_msgs::DiagnosticStatus::OK;
+  frames.message = dropped > 0 ? "images were dropped" : "ok";
+  diagnostic_msgs::KeyValue key_value;
+  key_value.key = "dropped by publish queue";
+  key_value.value = std::to_string(image_publish_worker_->getDroppedImages());
+  frames.values.push_back(key_value);
+  key_value.key = "dropped by capture pipeline";
+  key_value.value = std::to_string(pbo_frame_grabber_.getDroppedFrames());
+  frames.values.push_back(key_value);
+  key_value.key = "image buffer allocations";
+  key_value.value = std::to_string(view_image_pool_.getAllocations());
+  frames.values.push_back(key_value);
+  key_value.key = "image buffers in use";
+  key_value.value = std::to_string(view_image_pool_.getLentImages());
+  frames.values.push_back(key_value);
+  diagnostics.status.push_back(frames);
+
+  if(streaming_trajectory_ || dropped_stream_keyframes_ > 0)
+  {
+    diagnostic_msgs::DiagnosticStatus stream;
+    stream.name = "rviz_animated_view_controller: trajectory stream";
+    stream.level = dropped_stream_keyframes_ > 0 ? diagnostic_msgs::DiagnosticStatus::WARN :
+                                                   diagnostic_msgs::DiagnosticStatus::OK;
+    stream.message = dropped_stream_keyframes_ > 0 ? "keyframes were dropped" : "ok";
+    key_value.key = "buffered keyframes";
+    key_value.value = std::to_string(trajectory_.getPendingKeyframes());
+    stream.values.push_back(key_value);
+    key_value.key = "dropped keyframes";
+    key_value.value = std::to_string(dropped_stream_keyframes_);
+    stream.values.push_back(key_value);
+    diagnostics.status.push_back(stream);
+  }
+
+  statistics_publisher_.publish(diagnostics);
+}
+
+bool AnimatedViewController::updateAnimation()
+{
+  const double trajectory_time = computeTrajectoryTime();
+  const ros::Time stamp = computeSampleStamp(trajectory_time);
+  if(!updateReferencePose(stamp))
+    return false;
+  rendered_frames_counter_++;
+
+  size_t movement = 0;
+  Ogre::Vector3 new_position, new_focus, new_up;
+  // past the end we make sure to render the final pose before turning off
+  const bool finished_trajectory = !sampleTrajectory(trajectory_, trajectory_time, movement,
+                                                     new_position, new_focus, new_up);
+
+  if(!camera_state_active_)
+  {
+    camera_state_active_ = true;
+    last_synced_movement_ = movement;
+    last_property_sync_time_ = ros::WallTime::now();
+  }
+  camera_state_.eye = new_position;
+  camera_state_.focus = new_focus;
+  camera_state_.up = new_up;
+
+  // the properties only follow at a lower rate; the last pose of the trajectory is synced by cancelTransition().
+  // Dense trajectories change the movement almost every frame, so with a rate the movements are not synced
+  const double sync_rate = property_sync_rate_property_->getFloat();
+  if(sync_rate > 0.0 ? (ros::WallTime::now() - last_property_sync_time_).toSec() >= 1.0 / sync_rate
+                     : movement != last_synced_movement_)
+  {
+    syncPropertiesFromCameraState();
+    last_synced_movement_ = movement;
+  }
+
+  // This needs to happen so that the camera orientation will update properly when fixed_up_property == false
+  camera_->setFixedYawAxis(true, reference_orientation_ * new_up);
+  camera_->setDirection(reference_orientation_ * (new_focus - new_position));
+
+  publishCameraPose();
+
+  if(publish_view_images_property_->getBool())
+  {
+    sampleMotionBlur(trajectory_time);
+    publishViewImage(stamp);
+    renderBatchViews(trajectory_time, stamp);
+  }
+
+  if(render_frame_by_frame_)
+    rendered_frames_total_++;
+
+  if(finished_trajectory)
+    cancelTransition();
+  else
+    trajectory_.discardPlayedMovements();
+  return true;
+}
+
+bool AnimatedViewController::sampleTrajectory(CompiledTrajectory& trajectory, double time, size_t& movement,
+                                              Ogre::Vector3& eye, Ogre::Vector3& focus, Ogre::Vector3& up)
+{
+  double relative_progress_in_time = 0.0;
+  const bool in_trajectory = trajectory.sample(time, movement, relative_progress_in_time);
+
+  float relative_progress_in_space = computeRelativeProgressInSpace(relative_progress_in_time,
+                                                                    trajectory[movement].interpolation_speed);
+  interpolateTrajectory(trajectory, movement, relative_progress_in_space, eye, focus, up);
+  return in_trajectory;
+}
+
+void AnimatedViewController::sampleTrajectory(CompiledTrajectory& trajectory)
+{
+  const size_t count = sample_times_.size();
+  sample_relative_times_.resize(count);
+  sample_movements_.resize(count);
+  sample_progress_.resize(count);
+
+  size_t movement = 0;
+  for(size_t i = 0; i < count; ++i)
+  {
+    trajectory.sample(sample_times_[i], movement, sample_relative_times_[i]);
+    sample_movements_[i] = movement;
+  }
+
+  // all samples of a movement share its speed profile
+  for(size_t begin = 0, end = 0; begin < count; begin = end)
+  {
+    while(end < count && sample_movements_[end] == sample_movements_[begin])
+      ++end;
+    evaluateEasing(trajectory[sample_movements_[begin]].interpolation_speed, &sample_relative_times_[begin],
+                   &sample_progress_[begin], end - begin, bezier_easing_);
+  }
+}
+
+void AnimatedViewController::interpolateTrajectory(const CompiledTrajectory& trajectory, size_t movement,
+                                                   float relative_progress_in_space, Ogre::Vector3& eye,
+                                                   Ogre::Vector3& focus, Ogre::Vector3& up)
+{
+  switch(transition_mode_property_->getOptionInt())
+  {
+    case TRANSITION_SPHERICAL:
+      trajectory.interpolateSpherical(movement, relative_progress_in_space, eye, focus, up);
+      break;
+    case TRANSITION_SPLINE:
+      trajectory.interpolateSpline(movement, relative_progress_in_space, eye, focus, up);
+      break;
+    default:
+      trajectory.interpolateLinear(movement, relative_progress_in_space, eye, focus, up);
+      break;
+  }
+}
+
+void AnimatedViewController::renderBatchViews(double trajectory_time, const ros::Time& stamp)
+{
+  if(batch_views_.empty())
+    return;
 
-    double relative_progress_in_time = computeRelativeProgressInTime(goal->transition_duration);
+  if(!render_offscreen_property_->getBool())
+  {
+    ROS_WARN_ONCE("Batch views are only rendered while rendering offscreen.");
+    return;
+  }
+
+  configurePublishQueue();
+  const Ogre::ColourValue background_colour = getBackgroundColour();
+  const bool async = view_image_capture_mode_property_->getOptionInt() == CAPTURE_ASYNC_PIPELINED;
+
+  for(const std::unique_ptr<BatchView>& view : batch_views_)
+  {
+    if(!view->active || !view->trajectory.hasMovement())
+      continue;
 
-    // make sure we get all the way there before turning off
-    bool finished_current_movement = false;
-    if(relative_progress_in_time >= 1.0)
+    // the same sub-frames as the main view, sampled before the movements they fall into may be discarded
+    batch_view_motion_blur_poses_.resize(motion_blur_times_.size());
+    if(!motion_blur_times_.empty())
     {
-      relative_progress_in_time = 1.0;
-      finished_current_movement = true;
+      sample_times_.resize(motion_blur_times_.size());
+      for(size_t sample = 0; sample < sample_times_.size(); ++sample)
+        sample_times_[sample] = std::max(0.0, motion_blur_times_[sample] - view->start_time);
+      sampleTrajectory(view->trajectory);
+      for(size_t sample = 0; sample < batch_view_motion_blur_poses_.size(); ++sample)
+      {
+        CameraState& pose = batch_view_motion_blur_poses_[sample];
+        interpolateTrajectory(view->trajectory, sample_movements_[sample], sample_progress_[sample], pose.eye,
+                              pose.focus, pose.up);
+      }
     }
 
-    float relative_progress_in_space = computeRelativeProgressInSpace(relative_progress_in_time,
-                                                                      goal->interpolation_speed);
+    // views whose trajectory ended keep showing their final pose until the main trajectory ends
+    size_t movement = 0;
+    sampleTrajectory(view->trajectory, std::max(0.0, trajectory_time - view->start_time), movement,
+                     view->eye, view->focus, view->up);
+    view->trajectory.discardPlayedMovements();
+
+    // only the render thread resizes the publishers, reading them here needs no lock
+    if(batch_image_publishers_[view->index].getNumSubscribers() == 0)
+      continue;
+
+    view->render_target.configure(view->camera,
+                                  static_cast<unsigned int>(offscreen_width_property_->getInt()),
+                                  static_cast<unsigned int>(offscreen_height_property_->getInt()),
+                                  static_cast<unsigned int>(supersampling_property_->getInt()),
+                                  static_cast<unsigned int>(multisampling_property_->getInt()));
+    view->render_target.setBackgroundColour(background_colour);
+    view->image_pool.configure(view->render_target.getWidth(), view->render_target.getHeight(),
+                               sensor_msgs::image_encodings::BGR8,
+                               Ogre::PixelUtil::getNumElemBytes(Ogre::PF_BYTE_BGR));
+    {
+      TimingStatistics::ScopedTimer timer(timing_statistics_, TimingStatistics::RENDER_OFFSCREEN);
+      bool accumulated = !batch_view_motion_blur_poses_.empty();
+      for(size_t sample = 0; sample < batch_view_motion_blur_poses_.size() && accumulated; ++sample)
+      {
+        const CameraState& pose = batch_view_motion_blur_poses_[sample];
+        view->updateCamera(camera_, reference_orientation_, fixed_up_property_->getBool(), pose.eye, pose.focus,
+                           pose.up);
+        accumulated = view->render_target.accumulate(static_cast<unsigned int>(sample));
+      }
+      if(!batch_view_motion_blur_poses_.empty() && !accumulated)
+        ROS_WARN_ONCE("Sub-frame accumulation is not available, rendering batch views without motion blur.");
 
-    Ogre::Vector3 new_position = start->eye + relative_progress_in_space * (goal->eye - start->eye);
-    Ogre::Vector3 new_focus = start->focus + relative_progress_in_space * (goal->focus - start->focus);
-    Ogre::Vector3 new_up = start->up + relative_progress_in_space * (goal->up - start->up);
+      view->updateCamera(camera_, reference_orientation_, fixed_up_property_->getBool());
+      if(!accumulated)
+        view->render_target.render();
+    }
 
-    disconnectPositionProperties();
-    eye_point_property_->setVector( new_position );
-    focus_point_property_->setVector( new_focus );
-    up_vector_property_->setVector(new_up);
-    distance_property_->setFloat( getDistanceFromCameraToFocalPoint());
-    connectPositionProperties();
+    TimingStatistics::ScopedTimer timer(timing_statistics_, TimingStatistics::CAPTURE);
+    const unsigned int stream = BATCH_VIEW_STREAM + view->index;
+    if(async)
+    {
+      view->frame_grabber.setRingSize(static_cast<unsigned int>(capture_pipeline_depth_property_->getInt()));
+      view->frame_grabber.grabTexture(view->render_target.getTextureId(), view->render_target.getWidth(),
+                                      view->render_target.getHeight(), stamp);
+      publishPendingFrames(view->frame_grabber, view->image_pool, stream, false);
+      continue;
+    }
 
-    // This needs to happen so that the camera orientation will update properly when fixed_up_property == false
-    camera_->setFixedYawAxis(true, reference_orientation_ * up_vector_property_->getVector());
-    camera_->setDirection(reference_orientation_ * (focus_point_property_->getVector() - eye_point_property_->getVector()));
+    publishPendingFrames(view->frame_grabber, view->image_pool, stream, true);
+    sensor_msgs::ImagePtr image_msg = view->image_pool.acquire();
+    if(image_msg->data.empty())
+      continue;
 
-    publishCameraPose();
-    
-    if(publish_view_images_property_->getBool())
-      publishViewImage();
+    view->render_target.copyContentsToMemory(*image_msg);
+    pushViewImage(image_msg, stamp, stream);
+  }
+}
 
-    if(finished_current_movement)
-    {
-      // delete current start element in buffer
-      cam_movements_buffer_.pop_front();
+void AnimatedViewController::renderFramesOffline()
+{
+  if(!publish_view_images_property_->getBool() || !render_offscreen_property_->getBool())
+  {
+    // without an offscreen target every frame would read the same stale panel image
+    ROS_WARN_ONCE("Fast offline rendering requires view images to be published and rendered offscreen. "
+                  "Falling back to rendering one frame per update.");
+    updateAnimation();
+    return;
+  }
 
-      if(isMovementAvailable())
-        prepareNextMovement(goal->transition_duration);
-      else
-        cancelTransition();
+  const ros::WallTime slice_end = ros::WallTime::now() + ros::WallDuration(0.001 * offline_time_slice_property_->getInt());
+  do
+  {
+    // acknowledgements arrive on the callback spinner, so they can be waited for within the time slice
+    if(waitForAcknowledgements())
+    {
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+      continue;
     }
+    // a frame waiting for its transform is retried by the next update()
+    if(!updateAnimation())
+      break;
   }
-  updateCamera();
-  updateWindowSizeProperties();
+  while(animate_ && isMovementAvailable() && !animation_paused_ && ros::WallTime::now() < slice_end);
+
+  const double elapsed = (ros::WallTime::now() - frame_by_frame_start_time_).toSec();
+  if(elapsed > 0.0)
+    setStatus(QString::fromStdString("Offline rendering: " + std::to_string(rendered_frames_total_) + " frames, " +
+                                     std::to_string(static_cast<int>(rendered_frames_total_ / elapsed)) + " fps"));
 }
 
-void AnimatedViewController::pauseAnimationOnRequest()
+bool AnimatedViewController::waitForAcknowledgements()
 {
-  if(pause_animation_duration_.toSec() > 0.0)
+  if(!render_frame_by_frame_ || !acknowledge_view_images_property_->getBool()
+     || !output_manager_.hasSubscribers(OutputManager::VIEW_IMAGE))
+  {
+    // nobody left to acknowledge the images in flight
+    unacknowledged_view_images_.clear();
+    waiting_for_acknowledgement_ = false;
+    return false;
+  }
+
+  // sequence numbers grow in publish order, unlike the stamps, which go back after a seek
+  const uint32_t acknowledged = acknowledged_view_image_.load(std::memory_order_acquire);
+  while(!unacknowledged_view_images_.empty() && unacknowledged_view_images_.front() <= acknowledged)
+    unacknowledged_view_images_.pop_front();
+
+  if(unacknowledged_view_images_.size() < static_cast<size_t>(credit_window_property_->getInt()))
+  {
+    waiting_for_acknowledgement_ = false;
+    return false;
+  }
+
+  const ros::WallTime now = ros::WallTime::now();
+  if(!waiting_for_acknowledgement_)
   {
-    pause_animation_duration_.sleep();
-    transition_start_time_ += pause_animation_duration_;
-    pause_animation_duration_.fromSec(0.0);
+    waiting_for_acknowledgement_ = true;
+    acknowledgement_wait_start_time_ = now;
+    // images held back by the capture pipeline could never be acknowledged
+    publishPendingViewImages(true);
   }
+
+  const double timeout = acknowledgement_timeout_property_->getFloat();
+  if(timeout > 0.0 && (now - acknowledgement_wait_start_time_).toSec() >= timeout)
+  {
+    ROS_WARN("No acknowledgement for %zu view images within %.1f s, continuing the render.",
+             unacknowledged_view_images_.size(), timeout);
+    unacknowledged_view_images_.clear();
+    waiting_for_acknowledgement_ = false;
+    return false;
+  }
+  return true;
 }
 
-double AnimatedViewController::computeRelativeProgressInTime(const ros::Duration& transition_duration)
+bool AnimatedViewController::updatePauseState()
 {
-  double relative_progress_in_time = 0.0;
-  if(render_frame_by_frame_)
+  if(animation_paused_ && !pause_end_time_.isZero() && getClockTime() >= pause_end_time_)
   {
-    relative_progress_in_time = rendered_frames_counter_ / (target_fps_ * transition_duration.toSec());
-    rendered_frames_counter_++;
+    // resume exactly where the timed pause ends, independent of when update() notices it
+    const ros::Time now = getClockTime();
+    pause_start_time_ += now - pause_end_time_;
+    resumeAnimation();
   }
-  else
+  return animation_paused_;
+}
+
+double AnimatedViewController::computeTrajectoryTime()
+{
+  if(render_frame_by_frame_ || trajectory_clock_ == CLOCK_FRAME_LOCKED)
+    return rendered_frames_counter_ / static_cast<double>(getFrameRate());
+
+  const ros::Time now = getClockTime();
+  if(trajectory_start_time_.isZero())
   {
-    ros::WallDuration duration_from_start = ros::WallTime::now() - transition_start_time_;
-    relative_progress_in_time = duration_from_start.toSec() / transition_duration.toSec();
+    // the trajectory arrived before the first /clock message, it starts with the clock
+    trajectory_start_time_ = now;
+    if(animation_paused_)
+      pause_start_time_ = now;
   }
-  return relative_progress_in_time;
+  // a bag which is restarted moves ROS time backwards, hold the first pose until it catches up
+  return std::max(0.0, (now - trajectory_start_time_).toSec());
+}
+
+ros::Time AnimatedViewController::getClockTime() const
+{
+  if(trajectory_clock_ == CLOCK_ROS)
+    return ros::Time::now();
+
+  const ros::WallTime now = ros::WallTime::now();
+  return ros::Time(now.sec, now.nsec);
+}
+
+int AnimatedViewController::getFrameRate() const
+{
+  return std::max(1, render_frame_by_frame_ ? target_fps_ : frame_locked_rate_property_->getInt());
+}
+
+ros::Time AnimatedViewController::computeSampleStamp(double trajectory_time) const
+{
+  if(render_frame_by_frame_ || trajectory_clock_ == CLOCK_FRAME_LOCKED)
+    return trajectory_start_stamp_ + ros::Duration(trajectory_time);
+  if(trajectory_clock_ == CLOCK_ROS && !trajectory_start_time_.isZero())
+    return trajectory_start_time_ + ros::Duration(trajectory_time);
+  return ros::Time::now();
 }
 
 float AnimatedViewController::computeRelativeProgressInSpace(double relative_progress_in_time,
                                                              uint8_t interpolation_speed)
 {
-  switch(interpolation_speed)
+  return evaluateEasing(interpolation_speed, relative_progress_in_time, bezier_easing_);
+}
+
+void AnimatedViewController::publishViewImage(const ros::Time& stamp)
+{
+  const bool view_image = output_manager_.hasSubscribers(OutputManager::VIEW_IMAGE) || recording_video_;
+  bool preview_image = preview_property_->getBool() && output_manager_.hasSubscribers(OutputManager::PREVIEW_IMAGE);
+  if(preview_image && !isPreviewImage())
   {
-    case view_controller_msgs::CameraMovement::RISING:
-      return 1.f - static_cast<float>(cos(relative_progress_in_time * M_PI_2));
-    case view_controller_msgs::CameraMovement::DECLINING:
-      return static_cast<float>(-cos(relative_progress_in_time * M_PI_2 + M_PI_2));
-    case view_controller_msgs::CameraMovement::FULL:
-      return static_cast<float>(relative_progress_in_time);
-    case view_controller_msgs::CameraMovement::WAVE:
-    default:
-      return 0.5f * (1.f - static_cast<float>(cos(relative_progress_in_time * M_PI)));
+    ROS_WARN_ONCE("Preview images are only published while rendering offscreen.");
+    preview_image = false;
   }
+  if(!view_image && !preview_image)
+    return;
+
+  configurePublishQueue();
+
+  // the view image and its preview show the same frame, so they share the stamp
+  if(render_offscreen_property_->getBool())
+    renderOffscreenViewImage(view_image, preview_image);
+
+  TimingStatistics::ScopedTimer timer(timing_statistics_, TimingStatistics::CAPTURE);
+
+  if(view_image)
+    captureViewImage(stamp);
+  if(preview_image)
+    capturePreviewImage(stamp);
 }
 
-void AnimatedViewController::publishViewImage()
+void AnimatedViewController::streamViewImages()
 {
-  if(camera_view_image_publisher_.getNumSubscribers() > 0)
+  const bool subscribed = output_manager_.hasSubscribers(OutputManager::VIEW_IMAGE)
+                          || (preview_property_->getBool() && output_manager_.hasSubscribers(OutputManager::PREVIEW_IMAGE));
+  if(animate_ || !publish_view_images_property_->getBool() || !stream_view_images_property_->getBool() || !subscribed)
   {
-    std::shared_ptr<Ogre::PixelBox> pixel_box = std::make_shared<Ogre::PixelBox>();
-    getViewImage(pixel_box);
+    if(streaming_view_images_)
+    {
+      publishPendingViewImages(true);
+      streaming_view_images_ = false;
+    }
+    return;
+  }
+
+  const ros::WallTime now = ros::WallTime::now();
+  const double rate = stream_rate_property_->getFloat();
+  if(streaming_view_images_ && rate > 0.0 && (now - last_stream_time_).toSec() < 1.0 / rate)
+    return;
+
+  streaming_view_images_ = true;
+  last_stream_time_ = now;
+  publishViewImage(ros::Time::now());
+}
 
-    sensor_msgs::ImagePtr image_msg = sensor_msgs::ImagePtr(new sensor_msgs::Image());
-    convertImage(pixel_box, image_msg);
+void AnimatedViewController::configurePublishQueue()
+{
+  // every stream of a frame gets the configured depth, otherwise batch views would push each other out
+  const size_t streams = 1 + (isPreviewImage() ? 1 : 0) + batch_views_.size();
+  image_publish_worker_->setQueueDepth(static_cast<size_t>(publish_queue_depth_property_->getInt()) * streams);
+  image_publish_worker_->setOverflowPolicy(render_frame_by_frame_ ? ImagePublishWorker::BLOCK :
+                          static_cast<ImagePublishWorker::OverflowPolicy>(publish_queue_policy_property_->getOptionInt()));
+}
 
-    camera_view_image_publisher_.publish(image_msg);
+void AnimatedViewController::captureViewImage(const ros::Time& stamp)
+{
+  // after rendering, which determines the size of NV12 and resampled images
+  configureViewImagePool();
 
-    delete[] (unsigned char*)pixel_box->data;
+  if(view_image_capture_mode_property_->getOptionInt() == CAPTURE_ASYNC_PIPELINED)
+  {
+    grabViewImageAsync(stamp);
+    publishPendingFrames(pbo_frame_grabber_, view_image_pool_, VIEW_IMAGE_STREAM, false);
+    return;
   }
+
+  // the mode was switched during an animation, keep the image order
+  publishPendingFrames(pbo_frame_grabber_, view_image_pool_, VIEW_IMAGE_STREAM, true);
+
+  sensor_msgs::ImagePtr image_msg = view_image_pool_.acquire();
+  if(image_msg->data.empty())
+    return;
+
+  getViewImage(*image_msg);
+  pushViewImage(image_msg, stamp);
 }
 
-void AnimatedViewController::getViewImage(std::shared_ptr<Ogre::PixelBox>& pixel_box)
+void AnimatedViewController::capturePreviewImage(const ros::Time& stamp)
 {
-  const unsigned int image_height = context_->getViewManager()->getRenderPanel()->getRenderWindow()->getHeight();
-  const unsigned int image_width = context_->getViewManager()->getRenderPanel()->getRenderWindow()->getWidth();
+  preview_image_pool_.configure(preview_resample_pass_.getWidth(), preview_resample_pass_.getHeight(),
+                                sensor_msgs::image_encodings::BGR8,
+                                Ogre::PixelUtil::getNumElemBytes(Ogre::PF_BYTE_BGR));
+
+  if(view_image_capture_mode_property_->getOptionInt() == CAPTURE_ASYNC_PIPELINED)
+  {
+    preview_frame_grabber_.setRingSize(static_cast<unsigned int>(capture_pipeline_depth_property_->getInt()));
+    preview_frame_grabber_.grabTexture(preview_resample_pass_.getTextureId(), preview_resample_pass_.getWidth(),
+                                       preview_resample_pass_.getHeight(), stamp);
+    publishPendingFrames(preview_frame_grabber_, preview_image_pool_, PREVIEW_IMAGE_STREAM, false);
+    return;
+  }
+
+  publishPendingFrames(preview_frame_grabber_, preview_image_pool_, PREVIEW_IMAGE_STREAM, true);
+
+  sensor_msgs::ImagePtr image_msg = preview_image_pool_.acquire();
+  if(image_msg->data.empty())
+    return;
 
-  // create a PixelBox to store the rendered view image
-  const Ogre::PixelFormat pixel_format = Ogre::PF_BYTE_BGR;
-  const auto bytes_per_pixel = Ogre::PixelUtil::getNumElemBytes(pixel_format);
-  auto image_data = new unsigned char[image_width * image_height * bytes_per_pixel];
-  Ogre::Box image_extents(0, 0, image_width, image_height);
-  pixel_box = std::make_shared<Ogre::PixelBox>(image_extents, pixel_format, image_data);
-  context_->getViewManager()->getRenderPanel()->getRenderWindow()->copyContentsToMemory(*pixel_box,
-                                                                                        Ogre::RenderTarget::FB_AUTO);
+  preview_resample_pass_.copyContentsToMemory(*image_msg);
+  pushViewImage(image_msg, stamp, PREVIEW_IMAGE_STREAM);
 }
 
-void AnimatedViewController::convertImage(std::shared_ptr<Ogre::PixelBox> input_image,
-                                          sensor_msgs::ImagePtr output_image)
+void AnimatedViewController::renderOffscreenViewImage(bool view_image, bool preview_image)
 {
-  const auto bytes_per_pixel = Ogre::PixelUtil::getNumElemBytes(input_image->format);
-  const auto image_height = input_image->getHeight();
-  const auto image_width = input_image->getWidth();
+  offscreen_render_target_.configure(camera_,
+                                     static_cast<unsigned int>(offscreen_width_property_->getInt()),
+                                     static_cast<unsigned int>(offscreen_height_property_->getInt()),
+                                     static_cast<unsigned int>(supersampling_property_->getInt()),
+                                     static_cast<unsigned int>(multisampling_property_->getInt()));
+  offscreen_render_target_.setBackgroundColour(getBackgroundColour());
+
+  TimingStatistics::ScopedTimer timer(timing_statistics_, TimingStatistics::RENDER_OFFSCREEN);
+
+  bool accumulated = !motion_blur_poses_.empty();
+  for(size_t sample = 0; sample < motion_blur_poses_.size() && accumulated; ++sample)
+  {
+    setCameraPose(motion_blur_poses_[sample]);
+    accumulated = offscreen_render_target_.accumulate(static_cast<unsigned int>(sample));
+  }
+  if(!motion_blur_poses_.empty() && !accumulated)
+    ROS_WARN_ONCE("Sub-frame accumulation is not available, rendering view images without motion blur.");
+  motion_blur_poses_.clear();
+
+  // the panel renders after update() returns, the offscreen image has to show the current camera pose right now
+  updateCamera();
+  if(!accumulated)
+    offscreen_render_target_.render();
+
+  unsigned int texture_id = offscreen_render_target_.getTextureId();
+  unsigned int width = offscreen_render_target_.getWidth();
+  unsigned int height = offscreen_render_target_.getHeight();
+
+  if(preview_image
+     && !preview_resample_pass_.resample(texture_id, width, height, 0, 0, width, height,
+                                         static_cast<unsigned int>(preview_width_property_->getInt()),
+                                         static_cast<unsigned int>(preview_height_property_->getInt())))
+  {
+    ROS_WARN_ONCE("Image resampling is not available, no preview images are published.");
+  }
 
-  output_image->header.frame_id = attached_frame_property_->getStdString();
-  output_image->header.stamp = ros::Time::now();
-  output_image->height = image_height;
-  output_image->width = image_width;
-  output_image->encoding = sensor_msgs::image_encodings::BGR8;
-  output_image->is_bigendian = false;
-  output_image->step = static_cast<unsigned int>(image_width * bytes_per_pixel);
-  size_t size = image_width * image_height * bytes_per_pixel;
-  output_image->data.resize(size);
-  memcpy((char*)(&output_image->data[0]), input_image->data, size);
+  if(!view_image)
+    return;
+
+  if(isResampledViewImage())
+  {
+    unsigned int x, y, region_width, region_height;
+    getRegionOfInterest(width, height, x, y, region_width, region_height);
+    const unsigned int downscale = static_cast<unsigned int>(downscale_property_->getInt());
+    if(view_image_resample_pass_.resample(texture_id, width, height, x, y, region_width, region_height,
+                                          std::max(1u, region_width / downscale),
+                                          std::max(1u, region_height / downscale)))
+    {
+      texture_id = view_image_resample_pass_.getTextureId();
+      width = view_image_resample_pass_.getWidth();
+      height = view_image_resample_pass_.getHeight();
+    }
+    else
+    {
+      ROS_WARN_ONCE("Image resampling is not available, publishing uncropped full size view images instead.");
+    }
+  }
+
+  if(view_image_encoding_property_->getOptionInt() == IMAGE_ENCODING_NV12
+     && !nv12_conversion_pass_.convert(texture_id, width, height))
+  {
+    ROS_WARN_ONCE("NV12 conversion is not available, publishing bgr8 view images instead.");
+  }
 }
 
-void AnimatedViewController::prepareNextMovement(const ros::Duration& previous_transition_duration)
+void AnimatedViewController::throttleRenderPanel()
 {
-  transition_start_time_ += ros::WallDuration(previous_transition_duration.toSec());
-  rendered_frames_counter_ = 0;
+  Ogre::RenderWindow* render_window = getRenderWindow();
+  if(!render_window)
+    return;
+
+  const int frame_skip = panel_frame_skip_property_->getInt();
+  if(isOffscreenOnly())
+  {
+    // Ogre::Root::renderOneFrame() then only updates the offscreen targets, which the controller renders itself
+    render_panel_throttled_ = true;
+    render_window->setAutoUpdated(false);
+  }
+  else if(animate_ && frame_skip > 0 && publish_view_images_property_->getBool() && render_offscreen_property_->getBool())
+  {
+    render_panel_throttled_ = true;
+    render_window->setAutoUpdated(render_panel_frame_counter_++ % (frame_skip + 1) == 0);
+  }
+  else if(render_panel_throttled_)
+  {
+    render_panel_throttled_ = false;
+    render_panel_frame_counter_ = 0;
+    render_window->setAutoUpdated(true);
+  }
+}
+
+void AnimatedViewController::getViewImage(sensor_msgs::Image& image)
+{
+  if(isNv12ViewImage())
+  {
+    nv12_conversion_pass_.copyContentsToMemory(image);
+    return;
+  }
+
+  if(isResampledViewImage())
+  {
+    view_image_resample_pass_.copyContentsToMemory(image);
+    return;
+  }
+
+  if(render_offscreen_property_->getBool())
+  {
+    offscreen_render_target_.copyContentsToMemory(image);
+    return;
+  }
+
+  // read the region of interest straight from the back buffer into the message; the GL render window of Ogre
+  // ignores the offset of the box passed to copyContentsToMemory() and always reads the lower left corner
+  Ogre::RenderWindow* render_window = getRenderWindow();
+  if(!render_window)
+    return;
+  unsigned int x, y, width, height;
+  getRegionOfInterest(render_window->getWidth(), render_window->getHeight(), x, y, width, height);
+
+  // makes the context of the render window current and unbinds any render texture
+  Ogre::Root::getSingleton().getRenderSystem()->_setViewport(render_window->getViewport(0));
+  // GL counts rows from the bottom of the window
+  PboFrameGrabber::readWindow(x, render_window->getHeight() - y - height, width, height, image);
+}
+
+void AnimatedViewController::grabViewImageAsync(const ros::Time& stamp)
+{
+  pbo_frame_grabber_.setRingSize(static_cast<unsigned int>(capture_pipeline_depth_property_->getInt()));
+
+  if(isNv12ViewImage())
+  {
+    pbo_frame_grabber_.grabTexture(nv12_conversion_pass_.getTextureId(), nv12_conversion_pass_.getWidth(),
+                                   nv12_conversion_pass_.getHeight(), stamp, PboFrameGrabber::NV12);
+    return;
+  }
+
+  if(isResampledViewImage())
+  {
+    pbo_frame_grabber_.grabTexture(view_image_resample_pass_.getTextureId(), view_image_resample_pass_.getWidth(),
+                                   view_image_resample_pass_.getHeight(), stamp);
+    return;
+  }
+
+  if(render_offscreen_property_->getBool())
+  {
+    pbo_frame_grabber_.grabTexture(offscreen_render_target_.getTextureId(), offscreen_render_target_.getWidth(),
+                                   offscreen_render_target_.getHeight(), stamp);
+    return;
+  }
+
+  Ogre::RenderWindow* render_window = getRenderWindow();
+  if(!render_window)
+    return;
+
+  unsigned int x, y, width, height;
+  getRegionOfInterest(render_window->getWidth(), render_window->getHeight(), x, y, width, height);
+
+  // makes the context of the render window current and unbinds any render texture
+  Ogre::Root::getSingleton().getRenderSystem()->_setViewport(render_window->getViewport(0));
+  // GL counts rows from the bottom of the window
+  pbo_frame_grabber_.grab(x, render_window->getHeight() - y - height, width, height, stamp);
+}
+
+void AnimatedViewController::publishPendingViewImages(bool flush)
+{
+  publishPendingFrames(pbo_frame_grabber_, view_image_pool_, VIEW_IMAGE_STREAM, flush);
+  publishPendingFrames(preview_frame_grabber_, preview_image_pool_, PREVIEW_IMAGE_STREAM, flush);
+  for(const std::unique_ptr<BatchView>& view : batch_views_)
+    publishPendingFrames(view->frame_grabber, view->image_pool, BATCH_VIEW_STREAM + view->index, flush);
+}
+
+void AnimatedViewController::publishPendingFrames(PboFrameGrabber& frame_grabber, ImageBufferPool& pool,
+                                                  unsigned int stream, bool flush)
+{
+  while(frame_grabber.hasPendingFrames())
+  {
+    sensor_msgs::ImagePtr image_msg = pool.acquire();
+    ros::Time stamp;
+    if(!frame_grabber.retrieve(*image_msg, stamp, flush))
+      break;
+
+    pushViewImage(image_msg, stamp, stream);
+  }
+}
+
+void AnimatedViewController::pushViewImage(const sensor_msgs::ImagePtr& image, const ros::Time& stamp,
+                                           unsigned int stream)
+{
+  if(stream != VIEW_IMAGE_STREAM)
+  {
+    image_publish_worker_->push(image, stamp, attached_frame_property_->getStdString(), stream);
+    return;
+  }
+
+  // only images which are actually published can be acknowledged, so only they count towards the credit window
+  const uint32_t seq = ++view_image_seq_;
+  if(render_frame_by_frame_ && acknowledge_view_images_property_->getBool()
+     && output_manager_.hasSubscribers(OutputManager::VIEW_IMAGE))
+    unacknowledged_view_images_.push_back(seq);
+  image_publish_worker_->push(image, stamp, attached_frame_property_->getStdString(), stream, seq);
 }
 
 void AnimatedViewController::updateCamera()
 {
-  camera_->setPosition( eye_point_property_->getVector() );
-  camera_->setFixedYawAxis(fixed_up_property_->getBool(), reference_orientation_ * up_vector_property_->getVector());
-  camera_->setDirection( reference_orientation_ * (focus_point_property_->getVector() - eye_point_property_->getVector()));
+  const CameraState state = getCameraState();
+  setCameraPose(state);
   //camera_->setDirection( (focus_point_property_->getVector() - eye_point_property_->getVector()));
-  focal_shape_->setPosition( focus_point_property_->getVector() );
+  focal_shape_->setPosition( state.focus );
+}
+
+void AnimatedViewController::setCameraPose(const CameraState& state)
+{
+  camera_->setPosition( state.eye );
+  camera_->setFixedYawAxis(fixed_up_property_->getBool(), reference_orientation_ * state.up);
+  camera_->setDirection( reference_orientation_ * (state.focus - state.eye));
+}
+
+void AnimatedViewController::sampleMotionBlur(double trajectory_time)
+{
+  motion_blur_poses_.clear();
+  motion_blur_times_.clear();
+  const int samples = motion_blur_samples_property_->getInt();
+  if(samples < 2 || !render_offscreen_property_->getBool())
+  {
+    motion_blur_frame_time_ = -1.0;
+    return;
+  }
+
+  // the shutter closes at the frame time, so the last sub-frame is the pose the frame is published with
+  // clocked frames are as far apart as the trajectory moved since the previous one, not 1 / Frame Locked Rate
+  double frame_interval = 1.0 / getFrameRate();
+  if(!render_frame_by_frame_ && trajectory_clock_ != CLOCK_FRAME_LOCKED)
+  {
+    frame_interval = motion_blur_frame_time_ >= 0.0 ? trajectory_time - motion_blur_frame_time_ : 0.0;
+    motion_blur_frame_time_ = trajectory_time;
+    if(frame_interval <= 0.0)
+      return;
+  }
+
+  const double shutter = shutter_property_->getFloat() * frame_interval;
+  sample_times_.resize(static_cast<size_t>(samples));
+  for(int sample = 0; sample < samples; ++sample)
+    sample_times_[static_cast<size_t>(sample)] = std::max(0.0, trajectory_time
+                                                               - shutter * (samples - 1 - sample) / samples);
+  motion_blur_times_ = sample_times_;
+  sampleTrajectory(trajectory_);
+
+  motion_blur_poses_.resize(static_cast<size_t>(samples));
+  for(size_t sample = 0; sample < motion_blur_poses_.size(); ++sample)
+  {
+    CameraState& pose = motion_blur_poses_[sample];
+    interpolateTrajectory(trajectory_, sample_movements_[sample], sample_progress_[sample], pose.eye, pose.focus,
+                          pose.up);
+  }
+}
+
+AnimatedViewController::CameraState AnimatedViewController::getCameraState() const
+{
+  if(camera_state_active_)
+    return camera_state_;
+
+  CameraState state;
+  state.eye = eye_point_property_->getVector();
+  state.focus = focus_point_property_->getVector();
+  state.up = up_vector_property_->getVector();
+  return state;
+}
+
+void AnimatedViewController::syncPropertiesFromCameraState()
+{
+  if(!camera_state_active_)
+    return;
+
+  disconnectPositionProperties();
+  eye_point_property_->setVector( camera_state_.eye );
+  focus_point_property_->setVector( camera_state_.focus );
+  up_vector_property_->setVector( camera_state_.up );
+  distance_property_->setFloat( getDistanceFromCameraToFocalPoint());
+  connectPositionProperties();
+
+  last_property_sync_time_ = ros::WallTime::now();
 }
 
 void AnimatedViewController::yaw_pitch_roll( float yaw, float pitch, float roll )
@@ -0,0 +1,260 @@
+/*
+ * Copyright (c) 2012, Willow Garage, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Willow Garage, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "rviz_animated_view_controller/shader_pass.h"
+
+#include <ros/console.h>
+
+#define GL_GLEXT_PROTOTYPES
+#include <GL/gl.h>
+#include <GL/glext.h>
+
+#include <algorithm>
+#include <vector>
+
+namespace rviz_animated_view_controller
+{
+
+// the GL render system of Ogre 1.x runs a compatibility context, so fixed function vertices are fine
+static const char* const VERTEX_SHADER =
+  "#version 120\n"
+  "void main()\n"
+  "{\n"
+  "  gl_Position = gl_Vertex;\n"
+  "}\n";
+
+static GLuint compileShader(GLenum type, const char* source, const std::string& name)
+{
+  GLuint shader = glCreateShader(type);
+  glShaderSource(shader, 1, &source, nullptr);
+  glCompileShader(shader);
+
+  GLint compiled = GL_FALSE;
+  glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+  if(compiled != GL_TRUE)
+  {
+    GLint length = 0;
+    glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &length);
+    std::vector<char> log(std::max(1, length));
+    glGetShaderInfoLog(shader, static_cast<GLsizei>(log.size()), nullptr, log.data());
+    ROS_ERROR("Could not compile the %s shader: %s", name.c_str(), log.data());
+    glDeleteShader(shader);
+    return 0;
+  }
+  return shader;
+}
+
+ShaderPass::ShaderPass(const std::string& name, const char* fragment_shader, Format format)
+  : name_(name)
+    , fragment_shader_(fragment_shader)
+    , format_(format)
+    , program_(0)
+    , framebuffer_(0)
+    , texture_(0)
+    , width_(0)
+    , height_(0)
+    , program_failed_(false)
+{
+}
+
+ShaderPass::~ShaderPass()
+{
+  release();
+}
+
+void ShaderPass::release()
+{
+  if(framebuffer_ != 0)
+    glDeleteFramebuffers(1, &framebuffer_);
+  if(texture_ != 0)
+    glDeleteTextures(1, &texture_);
+  if(program_ != 0)
+    glDeleteProgram(program_);
+
+  program_ = 0;
+  framebuffer_ = 0;
+  texture_ = 0;
+  width_ = 0;
+  height_ = 0;
+}
+
+bool ShaderPass::createProgram()
+{
+  GLuint vertex_shader = compileShader(GL_VERTEX_SHADER, VERTEX_SHADER, name_);
+  GLuint fragment_shader = compileShader(GL_FRAGMENT_SHADER, fragment_shader_, name_);
+  if(vertex_shader == 0 || fragment_shader == 0)
+  {
+    glDeleteShader(vertex_shader);
+    glDeleteShader(fragment_shader);
+    return false;
+  }
+
+  program_ = glCreateProgram();
+  glAttachShader(program_, vertex_shader);
+  glAttachShader(program_, fragment_shader);
+  glLinkProgram(program_);
+
+  // the program keeps the shaders alive as long as it needs them
+  glDeleteShader(vertex_shader);
+  glDeleteShader(fragment_shader);
+
+  GLint linked = GL_FALSE;
+  glGetProgramiv(program_, GL_LINK_STATUS, &linked);
+  if(linked != GL_TRUE)
+  {
+    ROS_ERROR("Could not link the %s shader.", name_.c_str());
+    glDeleteProgram(program_);
+    program_ = 0;
+    return false;
+  }
+  return true;
+}
+
+void ShaderPass::configure(unsigned int width, unsigned int height)
+{
+  if(texture_ != 0 && width == width_ && height == height_)
+    return;
+
+  width_ = width;
+  height_ = height;
+
+  GLint previous_texture = 0, previous_framebuffer = 0;
+  glGetIntegerv(GL_TEXTURE_BINDING_2D, &previous_texture);
+  glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previous_framebuffer);
+
+  if(texture_ == 0)
+    glGenTextures(1, &texture_);
+  glBindTexture(GL_TEXTURE_2D, texture_);
+  if(format_ == R8)
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, width_, height_, 0, GL_RED, GL_UNSIGNED_BYTE, nullptr);
+  else if(format_ == RGB16F)
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, width_, height_, 0, GL_RGB, GL_FLOAT, nullptr);
+  else
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, width_, height_, 0, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+
+  if(framebuffer_ == 0)
+    glGenFramebuffers(1, &framebuffer_);
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffer_);
+  glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture_, 0);
+
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, previous_framebuffer);
+  glBindTexture(GL_TEXTURE_2D, previous_texture);
+}
+
+bool ShaderPass::run(unsigned int source_texture_id, unsigned int width, unsigned int height,
+                     const UniformSetter& set_uniforms, float blend_weight)
+{
+  if(program_failed_ || source_texture_id == 0)
+    return false;
+
+  if(program_ == 0 && !createProgram())
+  {
+    program_failed_ = true;
+    return false;
+  }
+
+  configure(std::max(1u, width), std::max(1u, height));
+
+  // Ogre caches the GL state, so everything touched here is restored exactly
+  GLint previous_framebuffer = 0, previous_program = 0, previous_active_texture = 0;
+  glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previous_framebuffer);
+  glGetIntegerv(GL_CURRENT_PROGRAM, &previous_program);
+  glGetIntegerv(GL_ACTIVE_TEXTURE, &previous_active_texture);
+  glPushAttrib(GL_ENABLE_BIT | GL_VIEWPORT_BIT | GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_POLYGON_BIT |
+               GL_SCISSOR_BIT | GL_STENCIL_BUFFER_BIT | GL_TEXTURE_BIT);
+
+  glActiveTexture(GL_TEXTURE0);
+  GLint previous_texture = 0, previous_min_filter = 0, previous_mag_filter = 0;
+  glGetIntegerv(GL_TEXTURE_BINDING_2D, &previous_texture);
+  glBindTexture(GL_TEXTURE_2D, source_texture_id);
+  glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, &previous_min_filter);
+  glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, &previous_mag_filter);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffer_);
+  glViewport(0, 0, width_, height_);
+  glDisable(GL_DEPTH_TEST);
+  glDisable(GL_STENCIL_TEST);
+  glDisable(GL_SCISSOR_TEST);
+  if(blend_weight < 1.0f)
+  {
+    // the blend colour is part of the colour buffer attributes pushed above
+    glEnable(GL_BLEND);
+    glBlendColor(0.f, 0.f, 0.f, blend_weight);
+    glBlendFunc(GL_CONSTANT_ALPHA, GL_ONE_MINUS_CONSTANT_ALPHA);
+  }
+  else
+  {
+    glDisable(GL_BLEND);
+  }
+  glDisable(GL_ALPHA_TEST);
+  glDisable(GL_CULL_FACE);
+  glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+  glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+
+  glUseProgram(program_);
+  glUniform1i(glGetUniformLocation(program_, "source"), 0);
+  if(set_uniforms)
+    set_uniforms(program_);
+  glRectf(-1.f, -1.f, 1.f, 1.f);
+
+  glUseProgram(previous_program);
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, previous_framebuffer);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, previous_min_filter);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, previous_mag_filter);
+  glBindTexture(GL_TEXTURE_2D, previous_texture);
+  glPopAttrib();
+  glActiveTexture(previous_active_texture);
+
+  return true;
+}
+
+void ShaderPass::copyContentsToMemory(void* data)
+{
+  if(texture_ == 0)
+    return;
+
+  GLint previous_texture = 0, previous_pack_alignment = 4;
+  glGetIntegerv(GL_TEXTURE_BINDING_2D, &previous_texture);
+  glGetIntegerv(GL_PACK_ALIGNMENT, &previous_pack_alignment);
+
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  glBindTexture(GL_TEXTURE_2D, texture_);
+  glGetTexImage(GL_TEXTURE_2D, 0, format_ == R8 ? GL_RED : GL_BGR, GL_UNSIGNED_BYTE, data);
+
+  glBindTexture(GL_TEXTURE_2D, previous_texture);
+  glPixelStorei(GL_PACK_ALIGNMENT, previous_pack_alignment);
+}
+
+}  // namespace rviz_animated_view_controller
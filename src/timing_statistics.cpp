@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) 2012, Willow Garage, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Willow Garage, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "rviz_animated_view_controller/timing_statistics.h"
+
+#include <algorithm>
+#include <sstream>
+#include <string>
+
+namespace rviz_animated_view_controller
+{
+
+static const char* SECTION_NAMES[TimingStatistics::SECTION_COUNT] = { "update",
+                                                                      "render offscreen",
+                                                                      "capture",
+                                                                      "publish",
+                                                                      "transform to attached frame",
+                                                                      "camera placement callback",
+                                                                      "camera trajectory callback" };
+
+static diagnostic_msgs::KeyValue makeKeyValue(const std::string& key, double value)
+{
+  std::ostringstream ss;
+  ss << value;
+
+  diagnostic_msgs::KeyValue key_value;
+  key_value.key = key;
+  key_value.value = ss.str();
+  return key_value;
+}
+
+static diagnostic_msgs::KeyValue makeKeyValue(const std::string& key, unsigned long value)
+{
+  // through the double overload, large counts would be printed in scientific notation
+  diagnostic_msgs::KeyValue key_value;
+  key_value.key = key;
+  key_value.value = std::to_string(value);
+  return key_value;
+}
+
+TimingStatistics::TimingStatistics(size_t window_size)
+  : enabled_(false)
+    , window_size_(std::max<size_t>(1, window_size))
+{
+}
+
+void TimingStatistics::record(Section section, double seconds)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  Window& window = windows_[section];
+  if(window.durations.size() < window_size_)
+    window.durations.push_back(static_cast<float>(seconds));
+  else
+    window.durations[window.next] = static_cast<float>(seconds);
+  window.next = (window.next + 1) % window_size_;
+  window.count++;
+  window.max = std::max(window.max, seconds);
+}
+
+void TimingStatistics::appendDiagnostics(diagnostic_msgs::DiagnosticArray& diagnostics) const
+{
+  std::vector<float> sorted;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  for(int section = 0; section < SECTION_COUNT; ++section)
+  {
+    const Window& window = windows_[section];
+
+    diagnostic_msgs::DiagnosticStatus status;
+    status.level = diagnostic_msgs::DiagnosticStatus::OK;
+    status.name = std::string("rviz_animated_view_controller: ") + SECTION_NAMES[section];
+    status.message = window.count > 0 ? "ok" : "no calls";
+    status.values.push_back(makeKeyValue("count", window.count));
+
+    if(!window.durations.empty())
+    {
+      sorted = window.durations;
+      std::sort(sorted.begin(), sorted.end());
+      auto percentile = [&sorted](double fraction)
+      {
+        return 1000.0 * sorted[static_cast<size_t>(fraction * (sorted.size() - 1) + 0.5)];
+      };
+      status.values.push_back(makeKeyValue("p50_ms", percentile(0.5)));
+      status.values.push_back(makeKeyValue("p95_ms", percentile(0.95)));
+      status.values.push_back(makeKeyValue("p99_ms", percentile(0.99)));
+      status.values.push_back(makeKeyValue("max_ms", 1000.0 * window.max));
+    }
+    diagnostics.status.push_back(status);
+  }
+}
+
+void TimingStatistics::reset()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  windows_.fill(Window());
+}
+
+const char* TimingStatistics::getSectionName(Section section)
+{
+  return SECTION_NAMES[section];
+}
+
+}  // namespace rviz_animated_view_controller
@@ -0,0 +1,278 @@
+/*
+ * Copyright (c) 2012, Willow Garage, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Willow Garage, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "rviz_animated_view_controller/trajectory_library.h"
+
+#include <ros/console.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+namespace rviz_animated_view_controller
+{
+
+static const char FILE_MAGIC[8] = {'R', 'A', 'V', 'C', 'T', 'R', 'J', '1'};
+
+struct FileHeader
+{
+  char magic[8];
+  uint8_t interaction_disabled;
+  uint8_t allow_free_yaw_axis;
+  uint8_t mouse_interaction_mode;
+  uint8_t render_frame_by_frame;
+  int32_t frames_per_second;
+  uint32_t target_frame_size;
+  uint32_t reserved;
+  uint64_t movement_count;
+};
+
+struct FileMovement
+{
+  float eye[3];
+  float focus[3];
+  float up[3];
+  uint32_t interpolation_speed;
+  double transition_duration;
+};
+
+static_assert(sizeof(FileHeader) == 32, "FileHeader must not contain padding");
+static_assert(sizeof(FileMovement) == 48, "FileMovement must not contain padding");
+
+/** @brief 64 bit FNV-1a hash. */
+static uint64_t hashBytes(const char* data, size_t size)
+{
+  uint64_t hash = 14695981039346656037ull;
+  for(size_t i = 0; i < size; ++i)
+  {
+    hash ^= static_cast<unsigned char>(data[i]);
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+TrajectoryLibrary::TrajectoryLibrary(size_t capacity)
+  : capacity_(std::max<size_t>(1, capacity))
+    , use_counter_(0)
+{
+}
+
+void TrajectoryLibrary::setCapacity(size_t capacity)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  capacity_ = std::max<size_t>(1, capacity);
+  evict();
+}
+
+void TrajectoryLibrary::setDirectory(const std::string& directory)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  directory_ = directory;
+}
+
+std::string TrajectoryLibrary::store(const CameraCommand& command)
+{
+  std::string buffer;
+  serialize(command, buffer);
+
+  // the magic is not part of the ID, the same trajectory keeps its ID even if the file format changes
+  char id[17];
+  snprintf(id, sizeof(id), "%016llx", static_cast<unsigned long long>(hashBytes(buffer.data() + sizeof(FILE_MAGIC),
+                                                                                buffer.size() - sizeof(FILE_MAGIC))));
+
+  std::shared_ptr<CameraCommand> stored(new CameraCommand(command));
+  stored->type = CameraCommand::MOVE;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  cache(id, stored);
+
+  if(!directory_.empty())
+  {
+    // written under another name first, so a concurrent load never maps a partially written file
+    const std::string file_name = getFileName(id);
+    const std::string temporary_name = file_name + ".tmp";
+    std::ofstream file(temporary_name, std::ios::binary | std::ios::trunc);
+    file.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    file.close();
+    if(!file || rename(temporary_name.c_str(), file_name.c_str()) != 0)
+    {
+      ROS_ERROR("Cannot write the trajectory %s to %s.", id, file_name.c_str());
+      remove(temporary_name.c_str());
+    }
+  }
+  return id;
+}
+
+std::shared_ptr<const CameraCommand> TrajectoryLibrary::find(const std::string& id)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto entry = entries_.find(id);
+  if(entry != entries_.end())
+  {
+    entry->second.last_use = ++use_counter_;
+    return entry->second.command;
+  }
+
+  std::shared_ptr<const CameraCommand> command = load(id);
+  if(command)
+    cache(id, command);
+  return command;
+}
+
+void TrajectoryLibrary::serialize(const CameraCommand& command, std::string& buffer)
+{
+  FileHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC));
+  header.interaction_disabled = command.interaction_disabled;
+  header.allow_free_yaw_axis = command.allow_free_yaw_axis;
+  header.mouse_interaction_mode = command.mouse_interaction_mode;
+  header.render_frame_by_frame = command.render_frame_by_frame;
+  header.frames_per_second = command.frames_per_second;
+  header.target_frame_size = static_cast<uint32_t>(command.target_frame.size());
+  header.movement_count = command.movements.size();
+
+  buffer.reserve(buffer.size() + sizeof(header) + command.target_frame.size()
+                 + command.movements.size() * sizeof(FileMovement));
+  buffer.append(reinterpret_cast<const char*>(&header), sizeof(header));
+  buffer.append(command.target_frame);
+
+  for(const OgreCameraMovement& movement : command.movements)
+  {
+    const FileMovement record = {{movement.eye.x, movement.eye.y, movement.eye.z},
+                                 {movement.focus.x, movement.focus.y, movement.focus.z},
+                                 {movement.up.x, movement.up.y, movement.up.z},
+                                 movement.interpolation_speed,
+                                 movement.transition_duration};
+    buffer.append(reinterpret_cast<const char*>(&record), sizeof(record));
+  }
+}
+
+std::shared_ptr<CameraCommand> TrajectoryLibrary::deserialize(const char* data, size_t size)
+{
+  FileHeader header;
+  if(size < sizeof(header))
+    return nullptr;
+  memcpy(&header, data, sizeof(header));
+
+  if(memcmp(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC)) != 0
+     || header.movement_count > (std::numeric_limits<size_t>::max() - sizeof(header)) / sizeof(FileMovement)
+     || size != sizeof(header) + header.target_frame_size + header.movement_count * sizeof(FileMovement))
+    return nullptr;
+
+  std::shared_ptr<CameraCommand> command(new CameraCommand(CameraCommand::MOVE));
+  command->interaction_disabled = header.interaction_disabled != 0;
+  command->allow_free_yaw_axis = header.allow_free_yaw_axis != 0;
+  command->mouse_interaction_mode = header.mouse_interaction_mode;
+  command->render_frame_by_frame = header.render_frame_by_frame != 0;
+  command->frames_per_second = header.frames_per_second;
+  command->target_frame.assign(data + sizeof(header), header.target_frame_size);
+
+  const char* records = data + sizeof(header) + header.target_frame_size;
+  command->movements.resize(header.movement_count);
+  for(size_t i = 0; i < command->movements.size(); ++i)
+  {
+    FileMovement record;
+    memcpy(&record, records + i * sizeof(record), sizeof(record));
+
+    OgreCameraMovement& movement = command->movements[i];
+    movement.eye = Ogre::Vector3(record.eye[0], record.eye[1], record.eye[2]);
+    movement.focus = Ogre::Vector3(record.focus[0], record.focus[1], record.focus[2]);
+    movement.up = Ogre::Vector3(record.up[0], record.up[1], record.up[2]);
+    movement.interpolation_speed = static_cast<uint8_t>(record.interpolation_speed);
+    movement.transition_duration = record.transition_duration;
+  }
+  return command;
+}
+
+std::string TrajectoryLibrary::getFileName(const std::string& id) const
+{
+  return directory_ + "/" + id + ".trajectory";
+}
+
+std::shared_ptr<CameraCommand> TrajectoryLibrary::load(const std::string& id) const
+{
+  // IDs are hex strings, anything else must not be turned into a path
+  if(directory_.empty() || id.empty() || id.find_first_not_of("0123456789abcdef") != std::string::npos)
+    return nullptr;
+
+  const std::string file_name = getFileName(id);
+  const int fd = open(file_name.c_str(), O_RDONLY);
+  if(fd < 0)
+    return nullptr;
+
+  std::shared_ptr<CameraCommand> command;
+  struct stat file_stat;
+  if(fstat(fd, &file_stat) == 0 && file_stat.st_size > 0)
+  {
+    const size_t size = static_cast<size_t>(file_stat.st_size);
+    void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if(mapped != MAP_FAILED)
+    {
+      command = deserialize(static_cast<const char*>(mapped), size);
+      munmap(mapped, size);
+    }
+  }
+  close(fd);
+
+  if(!command)
+    ROS_ERROR("The stored trajectory %s is corrupt.", file_name.c_str());
+  return command;
+}
+
+void TrajectoryLibrary::cache(const std::string& id, const std::shared_ptr<const CameraCommand>& command)
+{
+  Entry& entry = entries_[id];
+  entry.command = command;
+  entry.last_use = ++use_counter_;
+  evict();
+}
+
+void TrajectoryLibrary::evict()
+{
+  // the library holds a handful of trajectories, a linear search for the oldest one is cheap
+  while(entries_.size() > capacity_)
+  {
+    auto oldest = entries_.begin();
+    for(auto entry = entries_.begin(); entry != entries_.end(); ++entry)
+      if(entry->second.last_use < oldest->second.last_use)
+        oldest = entry;
+    entries_.erase(oldest);
+  }
+}
+
+}  // namespace rviz_animated_view_controller
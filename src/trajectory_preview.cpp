@@ -0,0 +1,158 @@
+/*
+ * Copyright (c) 2012, Willow Garage, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Willow Garage, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "rviz_animated_view_controller/trajectory_preview.h"
+
+#include <sensor_msgs/image_encodings.h>
+
+#include <OGRE/OgreCamera.h>
+#include <OGRE/OgreManualObject.h>
+#include <OGRE/OgreSceneManager.h>
+#include <OGRE/OgreSceneNode.h>
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+
+namespace rviz_animated_view_controller
+{
+
+static const Ogre::ColourValue EYE_PATH_COLOUR(1.0f, 0.6f, 0.0f);
+static const Ogre::ColourValue FOCUS_PATH_COLOUR(0.0f, 0.7f, 1.0f);
+
+TrajectoryPreview::TrajectoryPreview(Ogre::SceneManager* scene_manager, Ogre::SceneNode* attached_scene_node)
+  : scene_manager_(scene_manager)
+    , path_visible_(true)
+{
+  static unsigned int count = 0;
+  std::stringstream ss;
+  ss << "AnimatedViewControllerTrajectoryPreview" << count++;
+
+  path_ = scene_manager_->createManualObject(ss.str() + "Path");
+  path_->setDynamic(true);
+  attached_scene_node->attachObject(path_);
+
+  camera_ = scene_manager_->createCamera(ss.str() + "Camera");
+  camera_->setProjectionType(Ogre::PT_PERSPECTIVE);
+  attached_scene_node->attachObject(camera_);
+}
+
+TrajectoryPreview::~TrajectoryPreview()
+{
+  render_target_.destroy();
+  scene_manager_->destroyCamera(camera_);
+  scene_manager_->destroyManualObject(path_);
+}
+
+void TrajectoryPreview::setPath(const std::vector<Pose>& poses)
+{
+  path_->clear();
+  if(poses.size() < 2)
+    return;
+
+  path_->estimateVertexCount(2 * poses.size());
+  path_->begin("BaseWhiteNoLighting", Ogre::RenderOperation::OT_LINE_STRIP);
+  for(const Pose& pose : poses)
+  {
+    path_->position(pose.eye);
+    path_->colour(EYE_PATH_COLOUR);
+  }
+  path_->end();
+
+  path_->begin("BaseWhiteNoLighting", Ogre::RenderOperation::OT_LINE_STRIP);
+  for(const Pose& pose : poses)
+  {
+    path_->position(pose.focus);
+    path_->colour(FOCUS_PATH_COLOUR);
+  }
+  path_->end();
+}
+
+void TrajectoryPreview::clearPath()
+{
+  path_->clear();
+}
+
+void TrajectoryPreview::setPathVisible(bool visible)
+{
+  path_visible_ = visible;
+  path_->setVisible(visible);
+}
+
+void TrajectoryPreview::renderContactSheet(const std::vector<Pose>& poses, unsigned int columns,
+                                           unsigned int tile_width, unsigned int tile_height,
+                                           const Ogre::Camera* main_camera,
+                                           const Ogre::Quaternion& reference_orientation, bool fixed_up,
+                                           const Ogre::ColourValue& background_colour, sensor_msgs::Image& sheet)
+{
+  columns = std::max(1u, columns);
+  const unsigned int rows = (static_cast<unsigned int>(poses.size()) + columns - 1) / columns;
+  const size_t pixel_size = 3;
+
+  render_target_.configure(camera_, tile_width, tile_height, 1);
+  render_target_.setBackgroundColour(background_colour);
+  tile_width = render_target_.getWidth();
+  tile_height = render_target_.getHeight();
+
+  tile_.width = tile_width;
+  tile_.height = tile_height;
+  tile_.step = static_cast<unsigned int>(tile_width * pixel_size);
+  tile_.data.resize(tile_.step * tile_height);
+
+  sheet.width = columns * tile_width;
+  sheet.height = rows * tile_height;
+  sheet.encoding = sensor_msgs::image_encodings::BGR8;
+  sheet.is_bigendian = false;
+  sheet.step = static_cast<unsigned int>(sheet.width * pixel_size);
+  sheet.data.assign(static_cast<size_t>(sheet.step) * sheet.height, 0);
+
+  camera_->setNearClipDistance(main_camera->getNearClipDistance());
+  camera_->setFarClipDistance(main_camera->getFarClipDistance());
+  camera_->setFOVy(main_camera->getFOVy());
+
+  // the tiles show the shots, not the path through them
+  path_->setVisible(false);
+  for(size_t i = 0; i < poses.size(); ++i)
+  {
+    camera_->setPosition(poses[i].eye);
+    camera_->setFixedYawAxis(fixed_up, reference_orientation * poses[i].up);
+    camera_->setDirection(reference_orientation * (poses[i].focus - poses[i].eye));
+    render_target_.render();
+    render_target_.copyContentsToMemory(tile_);
+
+    const size_t x = (i % columns) * tile_width;
+    const size_t y = (i / columns) * tile_height;
+    for(unsigned int row = 0; row < tile_height; ++row)
+      memcpy(&sheet.data[(y + row) * sheet.step + x * pixel_size], &tile_.data[row * tile_.step], tile_.step);
+  }
+  path_->setVisible(path_visible_);
+}
+
+}  // namespace rviz_animated_view_controller
@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2012, Willow Garage, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Willow Garage, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "rviz_animated_view_controller/transform_cache.h"
+
+#include "rviz/frame_manager.h"
+
+#include <ros/console.h>
+#include <ros/time.h>
+
+namespace rviz_animated_view_controller
+{
+
+TransformCache::TransformCache(rviz::FrameManager* frame_manager,
+                               const std::string& attached_frame,
+                               const Ogre::Vector3& attached_frame_position,
+                               const Ogre::Quaternion& attached_frame_orientation)
+  : frame_manager_(frame_manager)
+    , attached_frame_(attached_frame)
+    , attached_frame_position_(attached_frame_position)
+    , attached_frame_orientation_inverse_(attached_frame_orientation.Inverse())
+{
+}
+
+const TransformCache::Transform& TransformCache::lookup(const std::string& frame_id)
+{
+  auto inserted = transforms_.emplace(frame_id, Transform());
+  Transform& transform = inserted.first->second;
+  if(!inserted.second)
+    return transform;
+
+  Ogre::Vector3 position = Ogre::Vector3::ZERO;
+  Ogre::Quaternion orientation = Ogre::Quaternion::IDENTITY;
+  if(!frame_manager_->getTransform(frame_id, ros::Time(), position, orientation))
+  {
+    ROS_WARN_STREAM("Could not transform from frame '" << frame_id << "', treating it as the fixed frame.");
+    position = Ogre::Vector3::ZERO;
+    orientation = Ogre::Quaternion::IDENTITY;
+  }
+
+  // fixed frame to attached frame: inv(attached) * (fixed from frame)
+  transform.rotation = attached_frame_orientation_inverse_ * orientation;
+  transform.translation = attached_frame_orientation_inverse_ * (position - attached_frame_position_);
+  return transform;
+}
+
+}  // namespace rviz_animated_view_controller
@@ -0,0 +1,347 @@
+/*
+ * Copyright (c) 2012, Willow Garage, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Willow Garage, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "rviz_animated_view_controller/video_recorder.h"
+
+#include <ros/console.h>
+
+#include <sensor_msgs/image_encodings.h>
+
+#include <algorithm>
+
+#ifdef HAVE_FFMPEG
+extern "C"
+{
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/pixdesc.h>
+#include <libswscale/swscale.h>
+}
+#endif
+
+namespace rviz_animated_view_controller
+{
+
+VideoRecorder::VideoRecorder()
+  : recording_(false)
+    , written_frames_(0)
+    , format_context_(nullptr)
+    , codec_context_(nullptr)
+    , stream_(nullptr)
+    , frame_(nullptr)
+    , packet_(nullptr)
+    , sws_context_(nullptr)
+    , input_format_(-1)
+    , input_width_(0)
+    , input_height_(0)
+{
+}
+
+VideoRecorder::~VideoRecorder()
+{
+  stop();
+}
+
+#ifdef HAVE_FFMPEG
+
+bool VideoRecorder::isAvailable()
+{
+  return true;
+}
+
+static AVPixelFormat toPixelFormat(const std::string& encoding)
+{
+  if(encoding == sensor_msgs::image_encodings::BGR8)
+    return AV_PIX_FMT_BGR24;
+  if(encoding == sensor_msgs::image_encodings::RGB8)
+    return AV_PIX_FMT_RGB24;
+  if(encoding == "nv12")
+    return AV_PIX_FMT_NV12;
+  return AV_PIX_FMT_NONE;
+}
+
+/** Prefers the input format, so e.g. NVENC takes NV12 images without any conversion. */
+static AVPixelFormat chooseEncoderFormat(const AVCodec* codec, AVPixelFormat input_format)
+{
+  if(!codec->pix_fmts)
+    return AV_PIX_FMT_YUV420P;
+
+  for(const AVPixelFormat* format = codec->pix_fmts; *format != AV_PIX_FMT_NONE; ++format)
+    if(*format == input_format)
+      return input_format;
+  return codec->pix_fmts[0];
+}
+
+void VideoRecorder::start(const Options& options)
+{
+  stop();
+
+#if LIBAVFORMAT_VERSION_INT < AV_VERSION_INT(58, 9, 100)
+  av_register_all();
+#endif
+
+  options_ = options;
+  options_.frames_per_second = std::max(1, options_.frames_per_second);
+  written_frames_ = 0;
+  recording_ = true;
+}
+
+bool VideoRecorder::open(const sensor_msgs::Image& image)
+{
+  const AVPixelFormat input_format = toPixelFormat(image.encoding);
+  if(input_format == AV_PIX_FMT_NONE)
+  {
+    ROS_ERROR("Cannot record view images of encoding %s.", image.encoding.c_str());
+    return false;
+  }
+
+  if(avformat_alloc_output_context2(&format_context_, nullptr, nullptr, options_.file_name.c_str()) < 0)
+  {
+    ROS_ERROR("Cannot determine the container format of %s.", options_.file_name.c_str());
+    return false;
+  }
+
+  stream_ = avformat_new_stream(format_context_, nullptr);
+  if(!stream_)
+    return false;
+
+  // hardware encoders like h264_nvenc are usually built in, but only open on hosts with the hardware
+  const AVCodec* codec = avcodec_find_encoder_by_name(options_.codec.c_str());
+  if(!codec)
+    ROS_WARN("Video encoder %s is not available, falling back to a software H.264 encoder.", options_.codec.c_str());
+  else if(!openEncoder(codec, image.width, image.height, input_format))
+    ROS_WARN("Cannot open the video encoder %s, falling back to a software H.264 encoder.", codec->name);
+
+  if(!codec_context_)
+  {
+    const AVCodec* requested = codec;
+    codec = avcodec_find_encoder_by_name("libx264");
+    if(!codec)
+      codec = avcodec_find_encoder(AV_CODEC_ID_H264);
+    if(!codec || codec == requested || !openEncoder(codec, image.width, image.height, input_format))
+    {
+      ROS_ERROR("No H.264 video encoder can be opened.");
+      return false;
+    }
+  }
+
+  avcodec_parameters_from_context(stream_->codecpar, codec_context_);
+  stream_->time_base = codec_context_->time_base;
+
+  if(!(format_context_->oformat->flags & AVFMT_NOFILE)
+     && avio_open(&format_context_->pb, options_.file_name.c_str(), AVIO_FLAG_WRITE) < 0)
+  {
+    ROS_ERROR("Cannot open %s for writing.", options_.file_name.c_str());
+    return false;
+  }
+
+  if(avformat_write_header(format_context_, nullptr) < 0)
+  {
+    ROS_ERROR("Cannot write the header of %s.", options_.file_name.c_str());
+    return false;
+  }
+
+  frame_ = av_frame_alloc();
+  packet_ = av_packet_alloc();
+  if(!frame_ || !packet_)
+    return false;
+  frame_->format = codec_context_->pix_fmt;
+  frame_->width = codec_context_->width;
+  frame_->height = codec_context_->height;
+  if(av_frame_get_buffer(frame_, 0) < 0)
+    return false;
+
+  input_format_ = input_format;
+  input_width_ = image.width;
+  input_height_ = image.height;
+
+  ROS_INFO("Recording view images to %s with %s (%s).", options_.file_name.c_str(), codec->name,
+           av_get_pix_fmt_name(codec_context_->pix_fmt));
+  return true;
+}
+
+bool VideoRecorder::openEncoder(const AVCodec* codec, unsigned int width, unsigned int height, int input_format)
+{
+  codec_context_ = avcodec_alloc_context3(codec);
+  if(!codec_context_)
+    return false;
+
+  // 4:2:0 formats need even dimensions, libswscale takes care of the odd pixel
+  codec_context_->width = static_cast<int>(width & ~1u);
+  codec_context_->height = static_cast<int>(height & ~1u);
+  codec_context_->pix_fmt = chooseEncoderFormat(codec, static_cast<AVPixelFormat>(input_format));
+  codec_context_->time_base = AVRational{1, options_.frames_per_second};
+  codec_context_->framerate = AVRational{options_.frames_per_second, 1};
+  codec_context_->gop_size = options_.frames_per_second;
+  codec_context_->bit_rate = options_.bit_rate;
+  if(format_context_->oformat->flags & AVFMT_GLOBALHEADER)
+    codec_context_->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+
+  if(avcodec_open2(codec_context_, codec, nullptr) < 0)
+  {
+    avcodec_free_context(&codec_context_);
+    return false;
+  }
+  return true;
+}
+
+bool VideoRecorder::write(const sensor_msgs::Image& image)
+{
+  if(!recording_)
+    return false;
+
+  if(!codec_context_ && !open(image))
+  {
+    close();
+    recording_ = false;
+    return false;
+  }
+
+  if(image.width != input_width_ || image.height != input_height_ || toPixelFormat(image.encoding) != input_format_)
+  {
+    ROS_WARN_THROTTLE(1.0, "The view image geometry changed during the recording, skipping images.");
+    return false;
+  }
+
+  if(av_frame_make_writable(frame_) < 0)
+    return false;
+
+  const uint8_t* source_planes[4] = {image.data.data(), nullptr, nullptr, nullptr};
+  int source_strides[4] = {static_cast<int>(image.step), 0, 0, 0};
+  if(input_format_ == AV_PIX_FMT_NV12)
+  {
+    // the interleaved chroma plane follows the luma rows
+    source_planes[1] = image.data.data() + static_cast<size_t>(image.step) * image.height;
+    source_strides[1] = static_cast<int>(image.step);
+  }
+
+  sws_context_ = sws_getCachedContext(sws_context_, static_cast<int>(input_width_), static_cast<int>(input_height_),
+                                      static_cast<AVPixelFormat>(input_format_),
+                                      codec_context_->width, codec_context_->height, codec_context_->pix_fmt,
+                                      SWS_BILINEAR, nullptr, nullptr, nullptr);
+  if(!sws_context_)
+    return false;
+  sws_scale(sws_context_, source_planes, source_strides, 0, static_cast<int>(input_height_),
+            frame_->data, frame_->linesize);
+
+  frame_->pts = static_cast<int64_t>(written_frames_);
+  if(!encode(frame_))
+  {
+    ROS_ERROR("Encoding frame %lu of %s failed, stopping the recording.", written_frames_, options_.file_name.c_str());
+    stop();
+    return false;
+  }
+
+  written_frames_++;
+  return true;
+}
+
+bool VideoRecorder::encode(AVFrame* frame)
+{
+  // a null frame flushes the encoder
+  if(avcodec_send_frame(codec_context_, frame) < 0)
+    return false;
+
+  while(true)
+  {
+    const int result = avcodec_receive_packet(codec_context_, packet_);
+    if(result == AVERROR(EAGAIN) || result == AVERROR_EOF)
+      return true;
+    if(result < 0)
+      return false;
+
+    av_packet_rescale_ts(packet_, codec_context_->time_base, stream_->time_base);
+    packet_->stream_index = stream_->index;
+    if(av_interleaved_write_frame(format_context_, packet_) < 0)
+      return false;
+  }
+}
+
+void VideoRecorder::stop()
+{
+  if(!recording_)
+    return;
+  recording_ = false;
+
+  if(codec_context_ && frame_)
+  {
+    encode(nullptr);
+    av_write_trailer(format_context_);
+    ROS_INFO("Recorded %lu frames to %s.", written_frames_, options_.file_name.c_str());
+  }
+  close();
+}
+
+void VideoRecorder::close()
+{
+  sws_freeContext(sws_context_);
+  av_packet_free(&packet_);
+  av_frame_free(&frame_);
+  avcodec_free_context(&codec_context_);
+  if(format_context_)
+  {
+    if(!(format_context_->oformat->flags & AVFMT_NOFILE))
+      avio_closep(&format_context_->pb);
+    avformat_free_context(format_context_);
+  }
+
+  sws_context_ = nullptr;
+  format_context_ = nullptr;
+  stream_ = nullptr;
+  input_format_ = -1;
+  input_width_ = 0;
+  input_height_ = 0;
+}
+
+#else  // HAVE_FFMPEG
+
+bool VideoRecorder::isAvailable()
+{
+  return false;
+}
+
+void VideoRecorder::start(const Options& options)
+{
+  ROS_ERROR("Cannot record %s, rviz_animated_view_controller was built without FFmpeg.",
+            options.file_name.c_str());
+}
+
+bool VideoRecorder::write(const sensor_msgs::Image&)
+{
+  return false;
+}
+
+void VideoRecorder::stop()
+{
+}
+
+#endif  // HAVE_FFMPEG
+
+}  // namespace rviz_animated_view_controller
@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) 2012, Willow Garage, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Willow Garage, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "rviz_animated_view_controller/attached_frame_history.h"
+
+#include <gtest/gtest.h>
+
+using rviz_animated_view_controller::AttachedFrameHistory;
+
+static const double EPSILON = 1e-5;
+
+TEST(AttachedFrameHistory, failsWithoutPoses)
+{
+  AttachedFrameHistory history;
+  Ogre::Vector3 position;
+  Ogre::Quaternion orientation;
+  EXPECT_FALSE(history.lookup(ros::Time(1.0), 0.1, position, orientation));
+}
+
+TEST(AttachedFrameHistory, interpolatesBetweenPoses)
+{
+  AttachedFrameHistory history;
+  history.add(ros::Time(1.0), Ogre::Vector3(0, 0, 0), Ogre::Quaternion::IDENTITY);
+  // 90 degrees about z
+  history.add(ros::Time(2.0), Ogre::Vector3(2, 4, 0), Ogre::Quaternion(std::sqrt(0.5f), 0, 0, std::sqrt(0.5f)));
+
+  Ogre::Vector3 position;
+  Ogre::Quaternion orientation;
+  ASSERT_TRUE(history.lookup(ros::Time(1.25), 0.0, position, orientation));
+  EXPECT_NEAR(0.5, position.x, EPSILON);
+  EXPECT_NEAR(1.0, position.y, EPSILON);
+  // 22.5 degrees about z
+  EXPECT_NEAR(std::cos(M_PI / 16), orientation.w, EPSILON);
+  EXPECT_NEAR(std::sin(M_PI / 16), orientation.z, EPSILON);
+}
+
+TEST(AttachedFrameHistory, holdsThePoseOutsideOfTheHistory)
+{
+  AttachedFrameHistory history;
+  history.add(ros::Time(1.0), Ogre::Vector3(1, 0, 0), Ogre::Quaternion::IDENTITY);
+
+  Ogre::Vector3 position;
+  Ogre::Quaternion orientation;
+  ASSERT_TRUE(history.lookup(ros::Time(5.0), 1.0, position, orientation));
+  EXPECT_NEAR(1.0, position.x, EPSILON);
+
+  history.add(ros::Time(2.0), Ogre::Vector3(2, 0, 0), Ogre::Quaternion::IDENTITY);
+  ASSERT_TRUE(history.lookup(ros::Time(0.5), 1.0, position, orientation));
+  EXPECT_NEAR(1.0, position.x, EPSILON);
+}
+
+TEST(AttachedFrameHistory, extrapolatesForALimitedTime)
+{
+  AttachedFrameHistory history;
+  history.add(ros::Time(1.0), Ogre::Vector3(0, 0, 0), Ogre::Quaternion::IDENTITY);
+  history.add(ros::Time(2.0), Ogre::Vector3(1, 0, 0), Ogre::Quaternion::IDENTITY);
+
+  Ogre::Vector3 position;
+  Ogre::Quaternion orientation;
+  ASSERT_TRUE(history.lookup(ros::Time(2.25), 0.5, position, orientation));
+  EXPECT_NEAR(1.25, position.x, EPSILON);
+  ASSERT_TRUE(history.lookup(ros::Time(10.0), 0.5, position, orientation));
+  EXPECT_NEAR(1.5, position.x, EPSILON);
+  ASSERT_TRUE(history.lookup(ros::Time(10.0), 0.0, position, orientation));
+  EXPECT_NEAR(1.0, position.x, EPSILON);
+}
+
+TEST(AttachedFrameHistory, ignoresPosesWhichAreNotNewer)
+{
+  AttachedFrameHistory history;
+  history.add(ros::Time(2.0), Ogre::Vector3(1, 0, 0), Ogre::Quaternion::IDENTITY);
+  history.add(ros::Time(2.0), Ogre::Vector3(5, 0, 0), Ogre::Quaternion::IDENTITY);
+  history.add(ros::Time(1.0), Ogre::Vector3(5, 0, 0), Ogre::Quaternion::IDENTITY);
+  EXPECT_EQ(1u, history.size());
+}
+
+TEST(AttachedFrameHistory, dropsTheOldestPosesBeyondTheCapacity)
+{
+  AttachedFrameHistory history(4);
+  for(int i = 1; i <= 10; ++i)
+    history.add(ros::Time(i), Ogre::Vector3(i, 0, 0), Ogre::Quaternion::IDENTITY);
+  EXPECT_EQ(4u, history.size());
+
+  Ogre::Vector3 position;
+  Ogre::Quaternion orientation;
+  ASSERT_TRUE(history.lookup(ros::Time(1.0), 0.0, position, orientation));
+  EXPECT_NEAR(7.0, position.x, EPSILON);
+
+  history.setCapacity(2);
+  EXPECT_EQ(2u, history.size());
+  ASSERT_TRUE(history.lookup(ros::Time(1.0), 0.0, position, orientation));
+  EXPECT_NEAR(9.0, position.x, EPSILON);
+}
+
+TEST(AttachedFrameHistory, clearsPosesOfOtherFrames)
+{
+  AttachedFrameHistory history;
+  history.setFrames("map", "base_link");
+  history.add(ros::Time(1.0), Ogre::Vector3(1, 0, 0), Ogre::Quaternion::IDENTITY);
+
+  history.setFrames("map", "base_link");
+  EXPECT_EQ(1u, history.size());
+  history.setFrames("odom", "base_link");
+  EXPECT_TRUE(history.empty());
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,313 @@
+/*
+ * Copyright (c) 2012, Willow Garage, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Willow Garage, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "rviz_animated_view_controller/compiled_trajectory.h"
+
+#include <gtest/gtest.h>
+
+using rviz_animated_view_controller::CompiledTrajectory;
+
+static Ogre::Vector3 point(float x)
+{
+  return Ogre::Vector3(x, 0.0f, 0.0f);
+}
+
+/** @brief Appends a start keyframe at x = 0 and @a movements movements of @a duration seconds, one unit each. */
+static void appendLine(CompiledTrajectory& trajectory, size_t movements, double duration)
+{
+  if(trajectory.empty())
+    trajectory.append(point(0.0f), point(0.0f), Ogre::Vector3::UNIT_Z, 0.0, 0);
+  const float start = trajectory[trajectory.size() - 1].eye.x;
+  for(size_t i = 1; i <= movements; ++i)
+    trajectory.append(point(start + i), point(start + i), Ogre::Vector3::UNIT_Z, duration, 0);
+}
+
+TEST(CompiledTrajectory, accumulatesKeyframeTimes)
+{
+  CompiledTrajectory trajectory;
+  EXPECT_TRUE(trajectory.empty());
+  EXPECT_FALSE(trajectory.hasMovement());
+
+  // the duration of the start keyframe is ignored and negative durations are clamped
+  trajectory.append(point(0.0f), point(0.0f), Ogre::Vector3::UNIT_Z, 5.0, 0);
+  EXPECT_FALSE(trajectory.hasMovement());
+  trajectory.append(point(1.0f), point(1.0f), Ogre::Vector3::UNIT_Z, 0.5, 0);
+  trajectory.append(point(2.0f), point(2.0f), Ogre::Vector3::UNIT_Z, -1.0, 0);
+  trajectory.append(point(3.0f), point(3.0f), Ogre::Vector3::UNIT_Z, 1.5, 0);
+
+  ASSERT_EQ(4u, trajectory.size());
+  EXPECT_TRUE(trajectory.hasMovement());
+  EXPECT_DOUBLE_EQ(0.0, trajectory[0].end_time);
+  EXPECT_DOUBLE_EQ(0.5, trajectory[1].end_time);
+  EXPECT_DOUBLE_EQ(0.5, trajectory[2].end_time);
+  EXPECT_DOUBLE_EQ(2.0, trajectory[3].end_time);
+  EXPECT_DOUBLE_EQ(2.0, trajectory.getDuration());
+  EXPECT_DOUBLE_EQ(0.5, trajectory.getStartTime(3));
+}
+
+TEST(CompiledTrajectory, samplesMovementAtTime)
+{
+  CompiledTrajectory trajectory;
+  appendLine(trajectory, 10, 1.0);
+
+  size_t movement = 0;
+  double progress = 0.0;
+  ASSERT_TRUE(trajectory.sample(0.0, movement, progress));
+  EXPECT_EQ(1u, movement);
+  EXPECT_DOUBLE_EQ(0.0, progress);
+
+  ASSERT_TRUE(trajectory.sample(3.25, movement, progress));
+  EXPECT_EQ(4u, movement);
+  EXPECT_DOUBLE_EQ(0.25, progress);
+
+  // a keyframe time belongs to the movement starting there
+  ASSERT_TRUE(trajectory.sample(4.0, movement, progress));
+  EXPECT_EQ(5u, movement);
+  EXPECT_DOUBLE_EQ(0.0, progress);
+
+  // jumps forward and backward need the binary search
+  ASSERT_TRUE(trajectory.sample(8.5, movement, progress));
+  EXPECT_EQ(9u, movement);
+  EXPECT_DOUBLE_EQ(0.5, progress);
+  ASSERT_TRUE(trajectory.sample(0.5, movement, progress));
+  EXPECT_EQ(1u, movement);
+  EXPECT_DOUBLE_EQ(0.5, progress);
+}
+
+TEST(CompiledTrajectory, samplesEveryTimeOfADenseTrajectory)
+{
+  CompiledTrajectory trajectory;
+  trajectory.append(point(0.0f), point(0.0f), Ogre::Vector3::UNIT_Z, 0.0, 0);
+  for(int i = 0; i < 3000; ++i)
+    trajectory.append(point(i), point(i), Ogre::Vector3::UNIT_Z, i % 7 == 0 ? 0.0 : 0.5, 0);
+
+  size_t movement = 0, previous_movement = 0;
+  double progress = 0.0;
+  for(double time = 0.0; time < trajectory.getDuration(); time += 0.01)
+  {
+    ASSERT_TRUE(trajectory.sample(time, movement, progress));
+    ASSERT_GE(movement, previous_movement);
+    ASSERT_LE(trajectory.getStartTime(movement), time);
+    ASSERT_LT(time, trajectory[movement].end_time);
+    ASSERT_GE(progress, 0.0);
+    ASSERT_LT(progress, 1.0);
+    previous_movement = movement;
+  }
+}
+
+TEST(CompiledTrajectory, completesLastMovementBeyondTheEnd)
+{
+  CompiledTrajectory trajectory;
+  appendLine(trajectory, 3, 1.0);
+
+  size_t movement = 0;
+  double progress = 0.0;
+  EXPECT_FALSE(trajectory.sample(3.0, movement, progress));
+  EXPECT_EQ(3u, movement);
+  EXPECT_DOUBLE_EQ(1.0, progress);
+  EXPECT_FALSE(trajectory.sample(1e9, movement, progress));
+  EXPECT_EQ(3u, movement);
+  EXPECT_DOUBLE_EQ(1.0, progress);
+  EXPECT_EQ(0u, trajectory.getPendingKeyframes());
+
+  // keyframes appended after the end are played from where the trajectory ended
+  appendLine(trajectory, 2, 1.0);
+  EXPECT_EQ(2u, trajectory.getPendingKeyframes());
+  EXPECT_TRUE(trajectory.sample(4.5, movement, progress));
+  EXPECT_EQ(5u, movement);
+  EXPECT_DOUBLE_EQ(0.5, progress);
+  EXPECT_EQ(1u, trajectory.getPendingKeyframes());
+}
+
+TEST(CompiledTrajectory, interpolatesLinearly)
+{
+  CompiledTrajectory trajectory;
+  appendLine(trajectory, 2, 1.0);
+
+  Ogre::Vector3 eye, focus, up;
+  trajectory.interpolateLinear(2, 0.25f, eye, focus, up);
+  EXPECT_FLOAT_EQ(1.25f, eye.x);
+  EXPECT_FLOAT_EQ(1.25f, focus.x);
+  EXPECT_FLOAT_EQ(1.0f, up.z);
+}
+
+TEST(CompiledTrajectory, splinePassesThroughKeyframes)
+{
+  CompiledTrajectory trajectory;
+  trajectory.append(Ogre::Vector3(0, 0, 0), Ogre::Vector3::ZERO, Ogre::Vector3::UNIT_Z, 0.0, 0);
+  trajectory.append(Ogre::Vector3(1, 2, 0), Ogre::Vector3::ZERO, Ogre::Vector3::UNIT_Z, 1.0, 0);
+  trajectory.append(Ogre::Vector3(3, 1, 0), Ogre::Vector3::ZERO, Ogre::Vector3::UNIT_Z, 2.0, 0);
+  trajectory.append(Ogre::Vector3(4, 4, 0), Ogre::Vector3::ZERO, Ogre::Vector3::UNIT_Z, 0.5, 0);
+
+  Ogre::Vector3 eye, focus, up;
+  for(size_t movement = 1; movement < trajectory.size(); ++movement)
+  {
+    trajectory.interpolateSpline(movement, 0.0f, eye, focus, up);
+    EXPECT_TRUE(eye.positionEquals(trajectory[movement - 1].eye, 1e-5f)) << "movement " << movement;
+    trajectory.interpolateSpline(movement, 1.0f, eye, focus, up);
+    EXPECT_TRUE(eye.positionEquals(trajectory[movement].eye, 1e-5f)) << "movement " << movement;
+  }
+}
+
+TEST(CompiledTrajectory, keepsPlayedKeyframesOfShortUnboundedTrajectories)
+{
+  CompiledTrajectory trajectory;
+  appendLine(trajectory, 100, 1.0);
+
+  size_t movement = 0;
+  double progress = 0.0;
+  trajectory.sample(90.5, movement, progress);
+  trajectory.discardPlayedMovements();
+  EXPECT_EQ(101u, trajectory.size());
+
+  // seeking back still finds the start
+  ASSERT_TRUE(trajectory.sample(0.5, movement, progress));
+  EXPECT_EQ(1u, movement);
+}
+
+TEST(CompiledTrajectory, discardsPlayedKeyframesOfLongUnboundedTrajectories)
+{
+  CompiledTrajectory trajectory;
+  appendLine(trajectory, 3000, 1.0);
+
+  size_t movement = 0;
+  double progress = 0.0;
+  trajectory.sample(2500.5, movement, progress);
+  ASSERT_EQ(2501u, movement);
+  trajectory.discardPlayedMovements();
+
+  // the start keyframe of the current movement and the one before it are kept
+  ASSERT_EQ(3001u - 2499u, trajectory.size());
+  EXPECT_DOUBLE_EQ(2499.0, trajectory[0].end_time);
+  EXPECT_DOUBLE_EQ(3000.0, trajectory.getDuration());
+  EXPECT_EQ(3000u - 2500u, trajectory.getPendingKeyframes());
+
+  // keyframe times are unchanged, so the trajectory time keeps counting from the original start
+  ASSERT_TRUE(trajectory.sample(2500.75, movement, progress));
+  EXPECT_DOUBLE_EQ(2500.0, trajectory.getStartTime(movement));
+  EXPECT_DOUBLE_EQ(0.75, progress);
+  ASSERT_TRUE(trajectory.sample(2999.5, movement, progress));
+  EXPECT_EQ(trajectory.size() - 1, movement);
+}
+
+TEST(CompiledTrajectory, refusesKeyframesBeyondTheMaximumSize)
+{
+  CompiledTrajectory trajectory;
+  trajectory.setMaxSize(4);
+  appendLine(trajectory, 3, 1.0);
+  EXPECT_TRUE(trajectory.isFull());
+  EXPECT_FALSE(trajectory.append(point(9.0f), point(9.0f), Ogre::Vector3::UNIT_Z, 1.0, 0));
+  EXPECT_EQ(4u, trajectory.size());
+
+  trajectory.setMaxSize(0);
+  EXPECT_FALSE(trajectory.isFull());
+  EXPECT_TRUE(trajectory.append(point(9.0f), point(9.0f), Ogre::Vector3::UNIT_Z, 1.0, 0));
+}
+
+TEST(CompiledTrajectory, reserveKeepsTheSlotsOfABoundedRing)
+{
+  CompiledTrajectory trajectory;
+  trajectory.setMaxSize(8);
+  EXPECT_EQ(8u, trajectory.getCapacity());
+
+  appendLine(trajectory, 5, 1.0);
+  trajectory.reserve(100);
+  EXPECT_EQ(8u, trajectory.getCapacity());
+  appendLine(trajectory, 2, 1.0);
+  EXPECT_TRUE(trajectory.isFull());
+  EXPECT_EQ(8u, trajectory.getCapacity());
+}
+
+TEST(CompiledTrajectory, recyclesSlotsOfABoundedRing)
+{
+  CompiledTrajectory trajectory;
+  trajectory.setMaxSize(8);
+  appendLine(trajectory, 7, 1.0);
+
+  // stream far more keyframes through the ring than it has slots, so it wraps around many times
+  size_t movement = 0;
+  double progress = 0.0;
+  double time = 0.0;
+  for(int step = 0; step < 1000; ++step)
+  {
+    time += 0.5;
+    ASSERT_TRUE(trajectory.sample(time, movement, progress));
+    trajectory.discardPlayedMovements();
+    while(!trajectory.isFull())
+      appendLine(trajectory, 1, 1.0);
+
+    ASSERT_EQ(8u, trajectory.size());
+    for(size_t i = 1; i < trajectory.size(); ++i)
+    {
+      ASSERT_DOUBLE_EQ(trajectory[i - 1].end_time + 1.0, trajectory[i].end_time);
+      ASSERT_FLOAT_EQ(trajectory[i - 1].eye.x + 1.0f, trajectory[i].eye.x);
+    }
+  }
+
+  ASSERT_TRUE(trajectory.sample(time, movement, progress));
+  EXPECT_LE(trajectory.getStartTime(movement), time);
+  EXPECT_LT(time, trajectory[movement].end_time);
+  // eye.x equals the keyframe time, interpolating at the sampled progress returns the time
+  Ogre::Vector3 eye, focus, up;
+  trajectory.interpolateLinear(movement, static_cast<float>(progress), eye, focus, up);
+  EXPECT_NEAR(time, eye.x, 1e-3);
+}
+
+TEST(CompiledTrajectory, keepsKeyframesWhenGrowing)
+{
+  CompiledTrajectory trajectory;
+  for(int message = 0; message < 200; ++message)
+  {
+    trajectory.reserve(3);
+    appendLine(trajectory, 3, 1.0);
+  }
+
+  ASSERT_EQ(601u, trajectory.size());
+  for(size_t i = 0; i < trajectory.size(); ++i)
+    ASSERT_FLOAT_EQ(static_cast<float>(i), trajectory[i].eye.x);
+}
+
+TEST(CompiledTrajectory, clearKeepsNothing)
+{
+  CompiledTrajectory trajectory;
+  appendLine(trajectory, 5, 1.0);
+  trajectory.clear();
+  EXPECT_TRUE(trajectory.empty());
+
+  appendLine(trajectory, 2, 2.0);
+  ASSERT_EQ(3u, trajectory.size());
+  EXPECT_DOUBLE_EQ(4.0, trajectory.getDuration());
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
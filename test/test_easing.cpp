@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2012, Willow Garage, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Willow Garage, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+#include "rviz_animated_view_controller/easing.h"
+
+#include <gtest/gtest.h>
+
+#include <initializer_list>
+#include <vector>
+
+using namespace rviz_animated_view_controller;
+
+/** @brief The speed profiles as the view controller evaluated them before easing.h existed. */
+static float legacyProgressInSpace(double relative_progress_in_time, uint8_t interpolation_speed)
+{
+  switch(interpolation_speed)
+  {
+    case view_controller_msgs::CameraMovement::RISING:
+      return 1.f - static_cast<float>(cos(relative_progress_in_time * M_PI_2));
+    case view_controller_msgs::CameraMovement::DECLINING:
+      return static_cast<float>(-cos(relative_progress_in_time * M_PI_2 + M_PI_2));
+    case view_controller_msgs::CameraMovement::FULL:
+      return static_cast<float>(relative_progress_in_time);
+    case view_controller_msgs::CameraMovement::WAVE:
+    default:
+      return 0.5f * (1.f - static_cast<float>(cos(relative_progress_in_time * M_PI)));
+  }
+}
+
+static std::vector<double> sampleTimes(size_t count)
+{
+  std::vector<double> times(count);
+  for(size_t i = 0; i < count; ++i)
+    times[i] = static_cast<double>(i) / (count - 1);
+  return times;
+}
+
+TEST(Easing, legacyProfilesAreBitCompatible)
+{
+  const CubicBezierEasing bezier;
+  const std::vector<double> times = sampleTimes(1001);
+  // 200 is no known profile and is played as WAVE, like before
+  for(uint8_t profile : std::initializer_list<uint8_t>{EASING_RISING, EASING_DECLINING, EASING_FULL, EASING_WAVE, 200})
+  {
+    std::vector<float> progress(times.size());
+    evaluateEasing(profile, times.data(), progress.data(), times.size(), bezier);
+    for(size_t i = 0; i < times.size(); ++i)
+    {
+      // exact comparisons on purpose, recorded trajectories must replay to the same poses
+      EXPECT_EQ(legacyProgressInSpace(times[i], profile), evaluateEasing(profile, times[i], bezier))
+        << "profile " << int(profile) << " at " << times[i];
+      EXPECT_EQ(legacyProgressInSpace(times[i], profile), progress[i])
+        << "profile " << int(profile) << " at " << times[i];
+    }
+  }
+}
+
+TEST(Easing, batchEqualsScalar)
+{
+  const CubicBezierEasing bezier(0.4, -0.2, 0.6, 1.3);
+  const std::vector<double> times = sampleTimes(257);
+  for(uint8_t profile : std::initializer_list<uint8_t>{EASING_CUBIC, EASING_QUINTIC, EASING_BEZIER})
+  {
+    std::vector<float> progress(times.size());
+    evaluateEasing(profile, times.data(), progress.data(), times.size(), bezier);
+    for(size_t i = 0; i < times.size(); ++i)
+      EXPECT_EQ(evaluateEasing(profile, times[i], bezier), progress[i])
+        << "profile " << int(profile) << " at " << times[i];
+  }
+}
+
+TEST(Easing, profilesStartAtZeroAndEndAtOne)
+{
+  const CubicBezierEasing bezier;
+  for(uint8_t profile = EASING_RISING; profile <= EASING_BEZIER; ++profile)
+  {
+    EXPECT_NEAR(0.0f, evaluateEasing(profile, 0.0, bezier), 1e-6f) << "profile " << int(profile);
+    EXPECT_NEAR(1.0f, evaluateEasing(profile, 1.0, bezier), 1e-6f) << "profile " << int(profile);
+  }
+}
+
+TEST(Easing, bezierParsesControlPoints)
+{
+  CubicBezierEasing bezier;
+  EXPECT_TRUE(bezier.parse("0, 0, 1, 1"));
+  // the linear curve
+  EXPECT_NEAR(0.25f, bezier.evaluate(0.25), 1e-5f);
+  EXPECT_NEAR(0.75f, bezier.evaluate(0.75), 1e-5f);
+
+  EXPECT_FALSE(bezier.parse("0.1, 0.2, 0.3"));
+  EXPECT_NEAR(0.25f, bezier.evaluate(0.25), 1e-5f);
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,238 @@
+/*
+ * Copyright (c) 2012, Willow Garage, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Willow Garage, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "rviz_animated_view_controller/trajectory_library.h"
+
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <stdlib.h>
+#include <unistd.h>
+
+using rviz_animated_view_controller::CameraCommand;
+using rviz_animated_view_controller::OgreCameraMovement;
+using rviz_animated_view_controller::TrajectoryLibrary;
+
+static CameraCommand makeCommand(size_t movements, float offset = 0.0f)
+{
+  CameraCommand command(CameraCommand::MOVE);
+  command.target_frame = "base_link";
+  command.frames_per_second = 30;
+  command.render_frame_by_frame = true;
+  command.mouse_interaction_mode = 2;
+  for(size_t i = 0; i < movements; ++i)
+  {
+    OgreCameraMovement movement;
+    movement.eye = Ogre::Vector3(offset + i, 2.0f, 3.0f);
+    movement.focus = Ogre::Vector3(0.0f, 0.0f, static_cast<float>(i));
+    movement.up = Ogre::Vector3::UNIT_Z;
+    movement.transition_duration = 0.5;
+    movement.interpolation_speed = static_cast<uint8_t>(i % 4);
+    command.movements.push_back(movement);
+  }
+  return command;
+}
+
+static void expectEqual(const CameraCommand& expected, const CameraCommand& actual)
+{
+  EXPECT_EQ(CameraCommand::MOVE, actual.type);
+  EXPECT_EQ(expected.target_frame, actual.target_frame);
+  EXPECT_EQ(expected.frames_per_second, actual.frames_per_second);
+  EXPECT_EQ(expected.render_frame_by_frame, actual.render_frame_by_frame);
+  EXPECT_EQ(expected.mouse_interaction_mode, actual.mouse_interaction_mode);
+  ASSERT_EQ(expected.movements.size(), actual.movements.size());
+  for(size_t i = 0; i < expected.movements.size(); ++i)
+  {
+    EXPECT_EQ(expected.movements[i].eye, actual.movements[i].eye);
+    EXPECT_EQ(expected.movements[i].focus, actual.movements[i].focus);
+    EXPECT_EQ(expected.movements[i].up, actual.movements[i].up);
+    EXPECT_EQ(expected.movements[i].transition_duration, actual.movements[i].transition_duration);
+    EXPECT_EQ(expected.movements[i].interpolation_speed, actual.movements[i].interpolation_speed);
+  }
+}
+
+/** @brief A fresh temporary directory, removed with its contents at the end of the test. */
+class TrajectoryLibraryDirectory : public testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    char name[] = "/tmp/trajectory_library_XXXXXX";
+    ASSERT_NE(nullptr, mkdtemp(name));
+    directory_ = name;
+  }
+
+  void TearDown() override
+  {
+    ASSERT_EQ(0, system(("rm -rf " + directory_).c_str()));
+  }
+
+  std::string directory_;
+};
+
+TEST(TrajectoryLibrary, findsStoredTrajectories)
+{
+  TrajectoryLibrary library;
+  const CameraCommand command = makeCommand(10);
+  const std::string id = library.store(command);
+
+  // IDs are 64 bit hashes in hex
+  EXPECT_EQ(16u, id.size());
+  EXPECT_EQ(std::string::npos, id.find_first_not_of("0123456789abcdef"));
+
+  std::shared_ptr<const CameraCommand> found = library.find(id);
+  ASSERT_TRUE(found != nullptr);
+  expectEqual(command, *found);
+}
+
+TEST(TrajectoryLibrary, derivesTheIdFromTheTrajectory)
+{
+  TrajectoryLibrary library;
+  EXPECT_EQ(library.store(makeCommand(10)), library.store(makeCommand(10)));
+  EXPECT_NE(library.store(makeCommand(10)), library.store(makeCommand(10, 1.0f)));
+  EXPECT_NE(library.store(makeCommand(10)), library.store(makeCommand(11)));
+}
+
+TEST(TrajectoryLibrary, storesPlayableCommands)
+{
+  TrajectoryLibrary library;
+  CameraCommand command = makeCommand(3);
+  command.type = CameraCommand::STREAM;
+
+  std::shared_ptr<const CameraCommand> found = library.find(library.store(command));
+  ASSERT_TRUE(found != nullptr);
+  EXPECT_EQ(CameraCommand::MOVE, found->type);
+}
+
+TEST(TrajectoryLibrary, evictsTheLeastRecentlyUsedTrajectories)
+{
+  TrajectoryLibrary library(2);
+  const std::string first = library.store(makeCommand(1));
+  const std::string second = library.store(makeCommand(2));
+  EXPECT_TRUE(library.find(first) != nullptr);
+
+  // second is the least recently used one now
+  const std::string third = library.store(makeCommand(3));
+  EXPECT_TRUE(library.find(first) != nullptr);
+  EXPECT_TRUE(library.find(second) == nullptr);
+  EXPECT_TRUE(library.find(third) != nullptr);
+
+  library.setCapacity(1);
+  EXPECT_TRUE(library.find(first) == nullptr);
+  EXPECT_TRUE(library.find(third) != nullptr);
+}
+
+TEST(TrajectoryLibrary, doesNotFindUnknownIds)
+{
+  TrajectoryLibrary library;
+  EXPECT_TRUE(library.find("0123456789abcdef") == nullptr);
+  EXPECT_TRUE(library.find("") == nullptr);
+}
+
+TEST_F(TrajectoryLibraryDirectory, loadsTrajectoriesStoredByAnotherLibrary)
+{
+  const CameraCommand command = makeCommand(1000);
+  std::string id;
+  {
+    TrajectoryLibrary library;
+    library.setDirectory(directory_);
+    id = library.store(command);
+  }
+  EXPECT_EQ(0, access((directory_ + "/" + id + ".trajectory").c_str(), F_OK));
+  // the temporary file was renamed
+  EXPECT_NE(0, access((directory_ + "/" + id + ".trajectory.tmp").c_str(), F_OK));
+
+  TrajectoryLibrary library;
+  library.setDirectory(directory_);
+  std::shared_ptr<const CameraCommand> found = library.find(id);
+  ASSERT_TRUE(found != nullptr);
+  expectEqual(command, *found);
+}
+
+TEST_F(TrajectoryLibraryDirectory, loadsEvictedTrajectories)
+{
+  TrajectoryLibrary library(1);
+  library.setDirectory(directory_);
+  const CameraCommand command = makeCommand(5);
+  const std::string id = library.store(command);
+  library.store(makeCommand(6));
+
+  std::shared_ptr<const CameraCommand> found = library.find(id);
+  ASSERT_TRUE(found != nullptr);
+  expectEqual(command, *found);
+}
+
+TEST_F(TrajectoryLibraryDirectory, rejectsIdsWhichAreNoHexStrings)
+{
+  // a file outside of the directory must not be reachable through the ID
+  TrajectoryLibrary library;
+  library.setDirectory(directory_ + "/library");
+  ASSERT_EQ(0, system(("mkdir " + directory_ + "/library").c_str()));
+  const std::string id = library.store(makeCommand(2));
+  ASSERT_EQ(0, rename((directory_ + "/library/" + id + ".trajectory").c_str(),
+                      (directory_ + "/outside.trajectory").c_str()));
+
+  TrajectoryLibrary other;
+  other.setDirectory(directory_ + "/library");
+  EXPECT_TRUE(other.find("../outside") == nullptr);
+  EXPECT_TRUE(other.find(id) == nullptr);
+  EXPECT_TRUE(other.find("0123456789ABCDEF") == nullptr);
+}
+
+TEST_F(TrajectoryLibraryDirectory, rejectsCorruptFiles)
+{
+  TrajectoryLibrary library;
+  library.setDirectory(directory_);
+  const std::string id = library.store(makeCommand(4));
+  const std::string file_name = directory_ + "/" + id + ".trajectory";
+
+  // truncated by one byte
+  std::ifstream in(file_name, std::ios::binary);
+  std::string contents((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  in.close();
+  std::ofstream(file_name, std::ios::binary | std::ios::trunc).write(contents.data(), contents.size() - 1);
+
+  TrajectoryLibrary truncated;
+  truncated.setDirectory(directory_);
+  EXPECT_TRUE(truncated.find(id) == nullptr);
+
+  // wrong magic
+  contents[0] = 'X';
+  std::ofstream(file_name, std::ios::binary | std::ios::trunc).write(contents.data(), contents.size());
+  TrajectoryLibrary wrong_magic;
+  wrong_magic.setDirectory(directory_);
+  EXPECT_TRUE(wrong_magic.find(id) == nullptr);
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}